@@ -4,11 +4,26 @@
 
 #include "gb_driver.h"
 #include "apu/apu_addrs.h"
+#include "apu/blip_buffer.h"
 #include "apu/channel_1.h"
 #include "apu/channel_2.h"
 #include "apu/channel_3.h"
 #include "apu/channel_4.h"
 
+// Maximum number of samples synthesized and handed to the driver at once
+#define AUDIO_BLOCK_SIZE 512
+
+// With synthesis off, pending clocks are only caught up on register access or after this many clocks
+#define SILENT_FLUSH_CLOCKS GB_CLOCK_RATE
+
+// The frame sequencer steps at 512 Hz, clocking length, sweep and envelope units
+#define SEQUENCER_CLOCKS (GB_CLOCK_RATE / 512)
+
+// Channel outputs (0-15) are scaled by this before band-limiting
+#define AMPLITUDE_SCALE 256
+
+// Maps the sum of four channels at full amplitude and master volume to 1.0
+#define MIX_SCALE (1.0F / (4 * 15 * AMPLITUDE_SCALE * 8))
 
 class APU {
     public:
@@ -23,9 +38,53 @@ class APU {
         void reset();
         void clock(uint8_t clocks);
 
+        // Synthesizes all audio up to the current cycle and hands it to the driver
+        void flush();
+
+        // With audio disabled no samples are produced, but length, sweep and channel
+        // status still advance so everything the CPU can read stays the same
+        void setAudioEnabled(bool enabled);
+
+    private:
+        // Runs every channel forward by clocks and mixes the resulting samples into block
+        uint32_t synthesize(uint32_t clocks);
+
+        // Steps a channel from one waveform edge to the next between block times start and end,
+        // recording each change in its blip buffer
+        template <typename T>
+        void synthesizeChannel(T &ch, uint8_t index, uint32_t start, uint32_t end);
+
+        // Records a change in the channel's output at block time
+        template <typename T>
+        void updateAmplitude(T &ch, uint8_t index, uint32_t time);
+
+        // Steps the length, sweep and envelope units due on the current sequencer step
+        void stepSequencer();
+
+        // Pans and scales the channel samples into interleaved stereo
+        void mix(uint32_t num_samples);
+
+        // Advances only the frame sequencer by clocks
+        void advanceSilently(uint32_t clocks);
+
+        // Picks up the driver's current rate adjustment
+        void updateOutputRate();
+
     private:
-        uint32_t clocks_to_sample;
-        uint32_t sample_frequency;
+        // clocks that have passed since audio was last synthesized
+        uint32_t pending_clocks;
+        uint32_t block_clocks;
+        uint32_t output_rate;
+        bool audio_enabled;
+
+        // clocks until the frame sequencer next steps, and which of its 8 steps that is
+        uint32_t sequencer_timer;
+        uint8_t sequencer_step;
+
+        std::array<BlipBuffer, 4> blips;
+        std::array<int16_t, 4> amplitudes;
+        std::array<std::array<int16_t, AUDIO_BLOCK_SIZE>, 4> channel_samples;
+        std::array<float, AUDIO_BLOCK_SIZE * 2> block;
 
         GameboyDriver *driver;
         std::array<uint8_t, 4> duty_cycles;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define BLIP_PHASE_BITS 6
+#define BLIP_PHASES (1 << BLIP_PHASE_BITS)
+#define BLIP_WIDTH 16       // taps in each band-limited step kernel
+#define BLIP_DELTA_BITS 15  // fixed point precision of the kernels
+#define BLIP_BASS_SHIFT 9   // strength of the DC-removing high-pass filter
+#define BLIP_FRAC_BITS 32   // fixed point precision of sample positions
+
+
+// Band-limited synthesis buffer. Amplitude changes are added at exact clock
+// times and turned into output samples when a block ends
+class BlipBuffer {
+    public:
+        BlipBuffer(uint32_t max_samples);
+        ~BlipBuffer() = default;
+
+    public:
+        void setRates(uint32_t clock_rate, uint32_t sample_rate);
+        void clear();
+
+        // Adds an amplitude change of delta at time clocks into the current block
+        void addDelta(uint32_t time, int32_t delta);
+
+        // Ends the current block after clocks clocks, making its samples available
+        void endBlock(uint32_t clocks);
+
+        uint32_t samplesAvailable();
+
+        // Reads up to count samples into out and returns the number read
+        uint32_t readSamples(int16_t *out, uint32_t count);
+
+    private:
+        // Position of the current block's start, in samples with BLIP_FRAC_BITS of fraction
+        uint64_t offset;
+        uint64_t factor;
+
+        int32_t integrator;
+        std::vector<int32_t> buffer;
+};
\ No newline at end of file
@@ -6,56 +6,16 @@
 #define WAVE_FREQ_TO_PERIOD(x) (2048 - x) * 2
 
 
-class Channel {
-    public:
-        virtual ~Channel() = default;
-
-    public:
-        virtual void reset() = 0;
-        virtual void clock(uint8_t clocks) = 0;
-        virtual uint8_t getOutput() = 0;
-        
-        virtual bool isEnabled() = 0;
-        virtual void setEnabled(bool enabled) = 0;
-
-    private:
-        virtual void trigger() = 0;
-};
-
-
-class LengthChannel : public Channel {
-    public:
-        virtual ~LengthChannel() = default;
-
-    public:
-        virtual uint8_t getLength() = 0;
-        virtual void setLength(uint8_t length) = 0;
-
-        virtual bool isLengthEnabled() = 0;
-        virtual void setLengthEnabled(bool enabled) = 0;
-};
-
-
-class SweepChannel : public Channel {
-    public:
-        virtual ~SweepChannel() = default;
-
-    public:
-        virtual uint16_t getFrequency() = 0;
-        virtual void setFrequency(uint16_t frequency) = 0;
-
-        virtual uint8_t getSweepShift() = 0;
-        virtual uint8_t getSweepPeriod() = 0;
-        virtual bool getSweepNegate() = 0;
-};
-
-class EnvelopeChannel : public Channel {
-    public:
-        virtual ~EnvelopeChannel() = default;
-
-    public:
-        virtual uint8_t getVolume() = 0;
-
-        virtual uint8_t getEnvelopePeriod() = 0;
-        virtual bool isAddModeEnabled() = 0;
-};
\ No newline at end of file
+// Channels are plain classes with no common base. The APU and each channel's
+// length, sweep and envelope units are templated on the concrete channel type,
+// so every call along the clock path is resolved at compile time. A channel provides:
+//
+//   void reset();
+//   void clock(uint32_t clocks);           steps the waveform forward by clocks
+//   uint8_t getOutput();
+//   uint32_t getClocksUntilStep();         clocks until the waveform next steps
+//   bool isEnabled();
+//   void setEnabled(bool enabled);
+//
+// plus whatever its units need, as listed in length_counter.h, frequency_sweep.h
+// and volume_envelope.h
\ No newline at end of file
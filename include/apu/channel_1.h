@@ -9,7 +9,7 @@
 #include "apu/volume_envelope.h"
 
 
-class Channel1 : public LengthChannel, public SweepChannel, public EnvelopeChannel {
+class Channel1 {
     public:
         Channel1();
         ~Channel1() = default;
@@ -18,38 +18,42 @@ class Channel1 : public LengthChannel, public SweepChannel, public EnvelopeChann
         bool regWrite(uint16_t addr, uint8_t data);
         bool regRead(uint16_t addr, uint8_t &val);
 
-        void reset() override;
-        void clock(uint8_t clocks) override;
-        uint8_t getOutput() override;
+        void reset();
+        void clock(uint32_t clocks);
+        uint8_t getOutput();
+        uint32_t getClocksUntilStep();
 
-        bool isEnabled() override;
-        void setEnabled(bool enabled) override;
+        bool isEnabled();
+        void setEnabled(bool enabled);
 
-        uint8_t getLength() override;
-        void setLength(uint8_t length) override;
+        uint8_t getLength();
+        void setLength(uint8_t length);
 
-        bool isLengthEnabled() override;
-        void setLengthEnabled(bool enabled) override;
+        bool isLengthEnabled();
+        void setLengthEnabled(bool enabled);
+        void stepLength();
 
-        uint16_t getFrequency() override;
-        void setFrequency(uint16_t frequency) override;
+        uint16_t getFrequency();
+        void setFrequency(uint16_t frequency);
 
-        uint8_t getSweepShift() override;
-        uint8_t getSweepPeriod() override;
-        bool getSweepNegate() override;
+        uint8_t getSweepShift();
+        uint8_t getSweepPeriod();
+        bool getSweepNegate();
+        void stepSweep();
 
-        uint8_t getVolume() override;
+        uint8_t getVolume();
 
-        uint8_t getEnvelopePeriod() override;
-        bool isAddModeEnabled() override;
+        uint8_t getEnvelopePeriod();
+        bool isAddModeEnabled();
+        void stepEnvelope();
 
     private:
-        LengthCounter len_counter;
-        FrequencySweep freq_sweep;
-        VolumeEnvelope envelope;
+        LengthCounter<Channel1> len_counter;
+        FrequencySweep<Channel1> freq_sweep;
+        VolumeEnvelope<Channel1> envelope;
 
     private:
-        void trigger() override;
+        void trigger();
 
         uint8_t getDuty();
 
@@ -8,7 +8,7 @@
 #include "apu/volume_envelope.h"
 
 
-class Channel2 : public LengthChannel, public EnvelopeChannel {
+class Channel2 {
     public:
         Channel2();
         ~Channel2() = default;
@@ -17,30 +17,33 @@ class Channel2 : public LengthChannel, public EnvelopeChannel {
         bool regWrite(uint16_t addr, uint8_t data);
         bool regRead(uint16_t addr, uint8_t &val);
 
-        void reset() override;
-        void clock(uint8_t clocks) override;
-        uint8_t getOutput() override;
+        void reset();
+        void clock(uint32_t clocks);
+        uint8_t getOutput();
+        uint32_t getClocksUntilStep();
 
-        bool isEnabled() override;
-        void setEnabled(bool enabled) override;
+        bool isEnabled();
+        void setEnabled(bool enabled);
 
-        uint8_t getLength() override;
-        void setLength(uint8_t length) override;
+        uint8_t getLength();
+        void setLength(uint8_t length);
 
-        bool isLengthEnabled() override;
-        void setLengthEnabled(bool enabled) override;
+        bool isLengthEnabled();
+        void setLengthEnabled(bool enabled);
+        void stepLength();
 
-        uint8_t getVolume() override;
+        uint8_t getVolume();
 
-        uint8_t getEnvelopePeriod() override;
-        bool isAddModeEnabled() override;
+        uint8_t getEnvelopePeriod();
+        bool isAddModeEnabled();
+        void stepEnvelope();
 
     private:
-        LengthCounter len_counter;
-        VolumeEnvelope envelope;
+        LengthCounter<Channel2> len_counter;
+        VolumeEnvelope<Channel2> envelope;
 
     private:
-        void trigger() override;
+        void trigger();
 
         uint16_t getFrequency();
         uint8_t getDuty();
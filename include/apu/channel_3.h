@@ -7,7 +7,7 @@
 #include "apu/length_counter.h"
 
 
-class Channel3 : public LengthChannel {
+class Channel3 {
     public:
         Channel3();
         ~Channel3() = default;
@@ -16,24 +16,26 @@ class Channel3 : public LengthChannel {
         bool regWrite(uint16_t addr, uint8_t data);
         bool regRead(uint16_t addr, uint8_t &val);
 
-        void reset() override;
-        void clock(uint8_t clocks) override;
-        uint8_t getOutput() override;
+        void reset();
+        void clock(uint32_t clocks);
+        uint8_t getOutput();
+        uint32_t getClocksUntilStep();
 
-        bool isEnabled() override;
-        void setEnabled(bool enabled) override;
+        bool isEnabled();
+        void setEnabled(bool enabled);
 
-        uint8_t getLength() override;
-        void setLength(uint8_t length) override;
+        uint8_t getLength();
+        void setLength(uint8_t length);
 
-        bool isLengthEnabled() override;
-        void setLengthEnabled(bool enabled) override;
+        bool isLengthEnabled();
+        void setLengthEnabled(bool enabled);
+        void stepLength();
 
     private:
-        LengthCounter len_counter;
+        LengthCounter<Channel3> len_counter;
 
     private:
-        void trigger() override;
+        void trigger();
 
         uint16_t getFrequency();
         uint8_t getVolumeCode();
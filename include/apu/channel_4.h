@@ -7,8 +7,11 @@
 #include "apu/length_counter.h"
 #include "apu/volume_envelope.h"
 
+#define LFSR15_PERIOD 32767
+#define LFSR7_PERIOD 127
 
-class Channel4 : public LengthChannel, public EnvelopeChannel {
+
+class Channel4 {
     public:
         Channel4();
         ~Channel4() = default;
@@ -17,30 +20,36 @@ class Channel4 : public LengthChannel, public EnvelopeChannel {
         bool regWrite(uint16_t addr, uint8_t data);
         bool regRead(uint16_t addr, uint8_t &val);
 
-        void reset() override;
-        void clock(uint8_t clocks) override;
-        uint8_t getOutput() override;
+        void reset();
+        void clock(uint32_t clocks);
+        uint8_t getOutput();
+        uint32_t getClocksUntilStep();
 
-        bool isEnabled() override;
-        void setEnabled(bool enabled) override;
+        bool isEnabled();
+        void setEnabled(bool enabled);
 
-        uint8_t getLength() override;
-        void setLength(uint8_t length) override;
+        uint8_t getLength();
+        void setLength(uint8_t length);
 
-        bool isLengthEnabled() override;
-        void setLengthEnabled(bool enabled) override;
+        bool isLengthEnabled();
+        void setLengthEnabled(bool enabled);
+        void stepLength();
 
-        uint8_t getVolume() override;
+        uint8_t getVolume();
 
-        uint8_t getEnvelopePeriod() override;
-        bool isAddModeEnabled() override;
+        uint8_t getEnvelopePeriod();
+        bool isAddModeEnabled();
+        void stepEnvelope();
 
     private:
-        LengthCounter len_counter;
-        VolumeEnvelope envelope;
+        LengthCounter<Channel4> len_counter;
+        VolumeEnvelope<Channel4> envelope;
 
     private:
-        void trigger() override;
+        void trigger();
+
+        // Steps the LFSR steps times at once
+        void advanceLFSR(uint32_t steps);
 
         uint8_t getClockShift();
         uint8_t getDivisor();
@@ -54,7 +63,7 @@ class Channel4 : public LengthChannel, public EnvelopeChannel {
 		uint8_t nr43;
 		uint8_t nr44;
 
-        uint16_t timer;
+        uint32_t timer;
         uint16_t lfsr;   // Linear feedback shift register
 
         bool enabled;
@@ -2,28 +2,72 @@
 
 #include <cstdint>
 
-#define FREQ_CLOCKS 32768 
-
-class SweepChannel;
-
-
+// Frequency sweep for channel type Ch, which provides getFrequency, setFrequency,
+// getSweepShift, getSweepPeriod, getSweepNegate and setEnabled
+template <typename Ch>
 class FrequencySweep {
     public:
-        FrequencySweep(SweepChannel *ch);
+        FrequencySweep(Ch *ch) : ch(ch) {}
         ~FrequencySweep() = default;
 
     public:
-        void reset();
-        void clock(uint8_t clocks);
-        void trigger();
+        void reset() {
+            shadow_register = ch->getFrequency();
+            timer = getReloadValue();
+            enabled = true;
+        }
+
+        void trigger() {
+            shadow_register = ch->getFrequency();
+            timer = getReloadValue();
+            enabled = ch->getSweepPeriod() || ch->getSweepShift();
+
+            if (ch->getSweepShift()) {
+                uint16_t new_frequency = recalculateFrequency();
+                if (new_frequency >= 0x800) ch->setEnabled(false);
+            }
+        }
+
+        // Called by the frame sequencer at 128 Hz
+        void step() {
+            if (--timer) {
+                return;
+            }
+
+            timer = getReloadValue();
+
+            if (ch->getSweepPeriod() && enabled) {
+                uint16_t new_frequency = recalculateFrequency();
+                if (new_frequency >= 0x800) {
+                    ch->setEnabled(false);
+                } else if (ch->getSweepShift()) {
+                    ch->setFrequency(new_frequency);
+                    shadow_register = new_frequency;
+                    new_frequency = recalculateFrequency();
+                    if (new_frequency >= 0x800) ch->setEnabled(false);
+                }
+            }
+        }
 
     private:
-        uint16_t recalculateFrequency();
+        uint16_t recalculateFrequency() {
+            if (ch->getSweepNegate()) {
+                return shadow_register - (shadow_register >> ch->getSweepShift());
+            } else {
+                return shadow_register + (shadow_register >> ch->getSweepShift());
+            }
+        }
+
+        uint8_t getReloadValue() {
+            // a period of 0 reloads the timer as if it were 8
+            uint8_t sweep_period = ch->getSweepPeriod();
+            return sweep_period ? sweep_period : 8;
+        }
 
     private:
-        SweepChannel *ch;
+        Ch *ch;
 
         uint16_t shadow_register;
-        uint16_t timer;
+        uint8_t timer;
         bool enabled;
 };
\ No newline at end of file
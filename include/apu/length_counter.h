@@ -2,24 +2,36 @@
 
 #include <cstdint>
 
-#define LEN_CLOCKS 16384
-
-class LengthChannel;
-
-
+// Length counter for channel type Ch, which provides getLength, setLength,
+// isLengthEnabled and setEnabled
+template <typename Ch>
 class LengthCounter {
     public:
-        LengthCounter(LengthChannel *ch);
+        LengthCounter(Ch *ch) : ch(ch) {}
         ~LengthCounter() = default;
 
     public:
-        void reset();
-        void clock(uint8_t clocks);
-        void trigger();
+        // Called by the frame sequencer at 256 Hz
+        void step() {
+            uint8_t len = ch->getLength();
+
+            // if length is disabled, there's nothing to do
+            if (ch->isLengthEnabled() && len) {
+                len--;
+                ch->setLength(len);
+
+                if (len == 0) {
+                    ch->setEnabled(false);
+                }
+            }
+        }
+
+        void trigger() {
+            if (!ch->getLength()) {
+                ch->setLength(0xFF);
+            }
+        }
 
     private:
-        LengthChannel *ch;
-
-        uint16_t length_timer;
-
+        Ch *ch;
 };
\ No newline at end of file
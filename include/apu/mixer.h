@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Mix with the plain per-sample loop instead of SSE
+//#define SCALAR_MIXER
+
+// Pans and scales four blocks of channel samples into interleaved stereo. Each channel
+// is multiplied by its left and right gain, which carry both NR51 routing and NR50 volume
+void mixChannels(const int16_t *const *channels, const float *left_gain, const float *right_gain,
+                 float *out, uint32_t num_samples);
\ No newline at end of file
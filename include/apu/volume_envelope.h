@@ -2,26 +2,59 @@
 
 #include <cstdint>
 
-#define ENVELOPE_CLOCKS 65536
-
-class EnvelopeChannel;
-
-
+// Volume envelope for channel type Ch, which provides getVolume,
+// getEnvelopePeriod and isAddModeEnabled
+template <typename Ch>
 class VolumeEnvelope {
     public:
-        VolumeEnvelope(EnvelopeChannel *ch);
+        VolumeEnvelope(Ch *ch) : ch(ch) {}
         ~VolumeEnvelope() = default;
 
     public:
-        void reset();
-        void clock(uint8_t clocks);
-        void trigger();
-        uint8_t getVolume();
+        void reset() {
+            trigger();
+        }
+
+        void trigger() {
+            timer = getReloadValue();
+            enabled = true;
+            internal_volume = ch->getVolume();
+        }
+
+        uint8_t getVolume() {
+            return internal_volume;
+        }
+
+        // Called by the frame sequencer at 64 Hz
+        void step() {
+            if (--timer) {
+                return;
+            }
+
+            timer = getReloadValue();
+
+            if (ch->getEnvelopePeriod()) {
+                if (ch->isAddModeEnabled() && internal_volume <= 0x0E) {
+                    internal_volume++;
+                } else if (!ch->isAddModeEnabled() && internal_volume >= 0x01) {
+                    internal_volume--;
+                } else {
+                    enabled = false;
+                }
+            }
+        }
+
+    private:
+        uint8_t getReloadValue() {
+            // a period of 0 reloads the timer as if it were 8
+            uint8_t envelope_period = ch->getEnvelopePeriod();
+            return envelope_period ? envelope_period : 8;
+        }
 
     private:
-        EnvelopeChannel *ch;
+        Ch *ch;
 
         uint8_t internal_volume;
-        uint32_t timer;
+        uint8_t timer;
         bool enabled;
 };
\ No newline at end of file
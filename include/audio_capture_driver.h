@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gb_driver.h"
+
+// Number of 16-bit values collected before a chunk is handed to the writer thread
+#define CAPTURE_CHUNK_SIZE 65536
+
+enum CAPTURE_FORMAT {CAPTURE_WAV, CAPTURE_RAW};
+
+
+// Wraps another driver, passing everything through while streaming the audio to a
+// file as 16-bit stereo PCM. File writes happen on a background thread in large chunks
+class AudioCaptureDriver : public GameboyDriver {
+    public:
+        AudioCaptureDriver(GameboyDriver *driver, const std::string &filename, CAPTURE_FORMAT format);
+        ~AudioCaptureDriver();
+
+    public:
+        void drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) override;
+        void render(bool frame_changed) override;
+        void pushSamples(const float *samples, uint32_t count) override;
+        bool quitReceived() override;
+        ControllerState pollControls() override;
+        double getRateAdjustment() override;
+        uint32_t getRenderInterval() override;
+        uint32_t getARGBColor(COLOR color) override;
+
+    private:
+        // Runs on the writer thread until the driver is destroyed
+        void writeLoop();
+
+        void writeHeader(uint32_t data_size);
+
+    private:
+        GameboyDriver *driver;
+        CAPTURE_FORMAT format;
+        std::ofstream file;
+
+        // filled by the emulation thread
+        std::vector<int16_t> chunk;
+
+        // full chunks waiting to be written
+        std::deque<std::vector<int16_t>> pending;
+        std::mutex pending_mutex;
+        std::condition_variable pending_cv;
+        bool done;
+
+        uint64_t data_size;
+        std::thread writer;
+};
\ No newline at end of file
@@ -1,14 +0,0 @@
-#pragma once
-
-#include <cstdint>
-
-typedef struct {
-    uint8_t ch1_left;
-    uint8_t ch1_right;
-    uint8_t ch2_left;
-    uint8_t ch2_right;
-    uint8_t ch3_left;
-    uint8_t ch3_right;
-    uint8_t ch4_left;
-    uint8_t ch4_right;
-} AudioOutput;
\ No newline at end of file
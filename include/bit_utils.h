@@ -2,4 +2,7 @@
 
 #include <cstdint>
 
-uint16_t highestOrderBit(uint16_t num);
\ No newline at end of file
+uint16_t highestOrderBit(uint16_t num);
+
+// Reverses the order of the bits in a byte
+uint8_t reverseBits(uint8_t byte);
\ No newline at end of file
@@ -10,15 +10,16 @@
 #include "ppu.h"
 #include "apu/apu.h"
 #include "timer.h"
+#include "serial.h"
+#include "debugger.h"
 #include "controls.h"
 #include "gb_driver.h"
 #include "interrupt.h"
 
 #define POLL_INTERVAL 210672
+#define DMA_CYCLES 640
 
 #define DMA 0xFF46
-#define SB 0xFF01 // serial bus
-#define SC 0xFF02 // serial control
 #define IF 0xFF0F // interrupt flag
 
 
@@ -32,7 +33,11 @@ class Bus {
         PPU ppu;
         APU apu;
         Timer timer;
+        Serial serial;
         Controls controls;
+#ifdef GB_DEBUGGER
+        Debugger debugger;
+#endif
         std::shared_ptr<Cartridge> cart;
         std::array<uint8_t, 8 * KB> ram;
         std::array<uint8_t, 0x7F> high_ram;
@@ -49,19 +54,56 @@ class Bus {
 
         void run();
 
+        // Run for at least the given number of cycles, polling controls as run() does.
+        // Returns the cycles actually run, which overshoot by up to one instruction.
+        // With the debugger compiled in, both return early when it stops
+        uint32_t runFor(uint32_t cycles);
+
+        bool quitReceived();
+
+        Serial &getSerial();
+
+#ifdef GB_DEBUGGER
+        Debugger &getDebugger();
+        CPU::REGISTERS getCPURegisters();
+#endif
+
         void insertCartridge(const std::shared_ptr<Cartridge> cart);
 
+        // Draw only every interval-th frame (0 draws none), starting with the next frame.
+        // Emulation results are unaffected
+        void setRenderInterval(uint32_t interval);
+
+        // Skip audio synthesis entirely. APU registers still read back as they would with audio on
+        void setAudioEnabled(bool enabled);
+
+        // Keep a copy of every byte the serial port sends on its own clock
+        void setSerialCapture(bool enabled);
+        const std::vector<uint8_t> &getSerialOutput();
+
+        // Hand all audio up to the current cycle to the driver
+        void flushAudio();
+
         void saveState(const std::string &filename);
         void loadState(const std::string &filename);
 
     private:
+        // Run a single instruction and clock everything else alongside it
+        uint8_t step();
+
         void handleDMA(uint8_t data);
+        void clockDMA(uint8_t clocks);
 
         void handleIOWrite(uint16_t addr, uint8_t data);
         uint8_t handleIORead(uint16_t addr);
 
     private:
-        uint8_t sb;
-        uint8_t sc;
         uint8_t intr_flag;
+
+        // cycles run by runFor since controls were last polled
+        uint32_t poll_cycles;
+
+        // OAM DMA state. While dma_cycles is nonzero the CPU can only access HRAM and IO registers
+        uint8_t dma;
+        uint16_t dma_cycles;
 };
@@ -31,6 +31,12 @@ public:
     void connectBus(Bus *bus);
     void requestInterrupt(INTERRUPT intr);
 
+    struct REGISTERS {
+        uint16_t af, bc, de, hl, sp, pc;
+    };
+
+    REGISTERS getRegisters();
+
 private:
     uint8_t read(uint16_t addr);
     void write(uint16_t addr, uint8_t data);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+// The hooks are only compiled into a core built with GB_DEBUGGER defined (gb-core-debug).
+// The regular core has no checks at all
+#define DEBUG_PAGE_SHIFT 8
+#define DEBUG_PAGES (0x10000 >> DEBUG_PAGE_SHIFT)
+
+enum WATCH_TYPE {WATCH_READ = 1 << 0, WATCH_WRITE = 1 << 1, WATCH_ACCESS = WATCH_READ | WATCH_WRITE};
+
+enum STOP_REASON {STOP_NONE, STOP_BREAKPOINT, STOP_WATCH_READ, STOP_WATCH_WRITE, STOP_STEP};
+
+
+// Breakpoints, watchpoints and stepping. Each address check first looks at a count of
+// entries for the address's page, so pages with nothing set cost a single load
+class Debugger {
+    public:
+        Debugger();
+        ~Debugger() = default;
+
+    public:
+        void addBreakpoint(uint16_t addr);
+        void removeBreakpoint(uint16_t addr);
+
+        void addWatchpoint(uint16_t addr, WATCH_TYPE type);
+        void removeWatchpoint(uint16_t addr);
+
+        void clear();
+
+        // Carry on from a stop, past a breakpoint on the instruction we stopped at
+        void resume();
+
+        // Resume for count instructions, then stop
+        void step(uint32_t count = 1);
+
+        bool isStopped();
+        STOP_REASON getStopReason();
+
+        // The instruction for breakpoints and steps, or the watched address
+        uint16_t getStopAddress();
+
+        // The value read or written by a watchpoint stop
+        uint8_t getStopValue();
+
+    public:
+        // Called by the CPU before each instruction it runs, never for halted cycles or
+        // interrupt dispatch. Returns true if the instruction should be held back
+        bool shouldStop(uint16_t pc) {
+            if (!(stopped | stepping | resuming) && !breakpoint_pages[pc >> DEBUG_PAGE_SHIFT]) {
+                return false;
+            }
+
+            return checkStop(pc);
+        }
+
+        void checkRead(uint16_t addr, uint8_t data) {
+            if (read_pages[addr >> DEBUG_PAGE_SHIFT] && reads[addr]) {
+                stop(STOP_WATCH_READ, addr, data);
+            }
+        }
+
+        void checkWrite(uint16_t addr, uint8_t data) {
+            if (write_pages[addr >> DEBUG_PAGE_SHIFT] && writes[addr]) {
+                stop(STOP_WATCH_WRITE, addr, data);
+            }
+        }
+
+    private:
+        bool checkStop(uint16_t pc);
+        void stop(STOP_REASON reason, uint16_t addr, uint8_t data);
+
+        // entries set on each page
+        std::array<uint16_t, DEBUG_PAGES> breakpoint_pages;
+        std::array<uint16_t, DEBUG_PAGES> read_pages;
+        std::array<uint16_t, DEBUG_PAGES> write_pages;
+
+        std::bitset<0x10000> breakpoints;
+        std::bitset<0x10000> reads;
+        std::bitset<0x10000> writes;
+
+        bool stopped;
+        bool stepping;
+        bool resuming;
+        uint32_t steps;
+
+        STOP_REASON stop_reason;
+        uint16_t stop_address;
+        uint8_t stop_value;
+};
\ No newline at end of file
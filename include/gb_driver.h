@@ -2,7 +2,6 @@
 
 #include <cstdint>
 
-#include "audio_output.h"
 #include "color.h"
 #include "controller_state.h"
 
@@ -10,6 +9,9 @@
 #define SCREEN_HEIGHT 144
 #define GB_CLOCK_RATE 4194304
 
+// Furthest the output sample rate can be stretched or squeezed, as a fraction
+#define MAX_RATE_ADJUSTMENT 0.005
+
 
 class GameboyDriver {
     public:
@@ -17,14 +19,16 @@ class GameboyDriver {
         virtual ~GameboyDriver() = default;
 
     public:
-        // Draw a pixel of specified color to the screen at location (x, y)
-        virtual void draw(COLOR color, uint8_t x, uint8_t y) = 0;
+        // Draw a full line of SCREEN_WIDTH pixels to the screen at row y
+        // colors holds a COLOR per pixel, and argb holds the same pixels as given by getARGBColor
+        virtual void drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) = 0;
 
-        // Render the screen and wait for the rest of the frame
-        virtual void render() = 0;
+        // Render the screen and wait for the rest of the frame. frame_changed is false when every
+        // line drawn since the last render matches the previous frame, so there's nothing new to show
+        virtual void render(bool frame_changed) = 0;
 
-        // Push an audio sample
-        virtual void pushSample(AudioOutput output) = 0;
+        // Push a block of count stereo samples, interleaved left then right
+        virtual void pushSamples(const float *samples, uint32_t count) = 0;
 
         // Return true if a QUIT input has been received
         virtual bool quitReceived() = 0;
@@ -32,6 +36,32 @@ class GameboyDriver {
         // Returns a ControllerState representing currently pressed controls
         virtual ControllerState pollControls() = 0;
 
+        // Returns the ratio the output sample rate should currently be stretched by, letting the
+        // driver hold its audio buffer at a steady level. Clamped to 1 +- MAX_RATE_ADJUSTMENT
+        virtual double getRateAdjustment() {
+            return 1.0;
+        }
+
+        // Returns how many frames pass for each one that gets drawn, on top of the bus's render
+        // interval. Polled at the start of every frame, so a driver running faster than it can
+        // show frames can skip composing the ones it would drop
+        virtual uint32_t getRenderInterval() {
+            return 1;
+        }
+
+        // Returns the ARGB8888 value a color is displayed as
+        virtual uint32_t getARGBColor(COLOR color) {
+            static const uint32_t colors[] = {
+                0x9BBC0F, // WHITE
+                0x8BAC0F, // LIGHT_GREEN
+                0x306230, // DARK_GREEN
+                0x0F380F, // BLACK
+                0xFFFFFF, // UNLIT
+            };
+
+            return colors[color];
+        }
+
     public:
         const uint32_t sampling_rate;
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "gb_driver.h"
+
+#define HEADLESS_SAMPLE_RATE 48000
+
+
+// Driver for running without a window or audio device. The last drawn frame
+// is kept in memory and audio is discarded
+class HeadlessGameboyDriver : public GameboyDriver {
+    public:
+        // Quits after frame_limit frames, or never if frame_limit is 0
+        HeadlessGameboyDriver(uint32_t frame_limit = 0);
+        ~HeadlessGameboyDriver() = default;
+
+    public:
+        // Draw a full line of SCREEN_WIDTH pixels to the screen at row y
+        void drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) override;
+
+        // Count the frame, quitting once the limit is reached
+        void render(bool frame_changed) override;
+
+        // Push a block of count stereo samples, interleaved left then right
+        void pushSamples(const float *samples, uint32_t count) override;
+
+        // Return true if a QUIT input has been received
+        bool quitReceived() override;
+
+        // Returns a ControllerState with nothing pressed
+        ControllerState pollControls() override;
+
+        uint32_t getFrameCount();
+
+        // Returns SCREEN_WIDTH * SCREEN_HEIGHT COLORs, row by row
+        const uint8_t *getFrame();
+
+        // FNV-1a hash of the last frame, for comparing runs
+        uint64_t getFrameHash();
+
+    private:
+        std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> frame;
+
+        uint32_t frame_count;
+        uint32_t frame_limit;
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "bus.h"
+
+// Longest stretch either machine runs before meeting the other. A transfer takes
+// SERIAL_TRANSFER_CYCLES, so one started within a chunk always finishes at or past its end
+#define LINK_QUANTUM SERIAL_TRANSFER_CYCLES
+
+
+// Connects the serial ports of two machines in the same process. Both run in lockstep
+// chunks that end at the next transfer, so bytes are swapped with both sides at the
+// same cycle
+class LinkCable {
+    public:
+        LinkCable(Bus *first, Bus *second);
+        ~LinkCable();
+
+    public:
+        // Run both machines until either one quits. Threaded runs each on its own thread,
+        // meeting at the end of every chunk
+        void run(bool threaded);
+
+        // Bytes exchanged so far
+        uint64_t getTransferCount();
+
+    private:
+        // Run a machine up to the end of the current chunk
+        void runToTarget(uint32_t index);
+
+        // Swap bytes for any transfer that finished this chunk, then pick where the next ends
+        void exchange();
+        void scheduleChunk();
+
+        std::array<Bus *, 2> buses;
+
+        // cycles each machine has run. Instructions overshoot a chunk, so these can differ slightly
+        std::array<uint64_t, 2> times;
+        uint64_t target;
+
+        uint64_t transfers;
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include "gb_driver.h"
+#include "scanline.h"
 #include "sprite.h"
 
 // Important PPU ram locations
@@ -22,6 +23,13 @@
 #define OAM_START 0xFE00
 #define OAM_END 0xFEA0
 #define OAM_SIZE 0xA0
+#define MAX_LINE_SPRITES 10
+
+// Compose lines with the per-pixel reference implementation instead of the planar compositor
+//#define SCALAR_COMPOSITOR
+
+// Compose every line with both compositors and throw if they disagree
+//#define VERIFY_COMPOSITOR
 
 class Bus;
 
@@ -37,6 +45,10 @@ public:
     void cpuWrite(uint16_t addr, uint8_t data);
     uint8_t cpuRead(uint16_t addr);
 
+    // Copies OAM_SIZE bytes from src into OAM for an OAM DMA transfer
+    // DMA has access to OAM regardless of the PPU mode
+    void dmaTransfer(const uint8_t *src);
+
     // Handles reads/writes to PPU high ram registers
     bool regWrite(uint16_t addr, uint8_t data);
     bool regRead(uint16_t addr, uint8_t &val);
@@ -45,6 +57,11 @@ public:
     void clock(uint8_t clocks);
     void connectBus(Bus *bus);
 
+    // Only every interval-th frame is composed and drawn, and an interval of 0 skips every frame
+    // A change takes effect from the next frame. Mode timing, interrupts and memory behave the
+    // same whether or not a frame is drawn
+    void setRenderInterval(uint32_t interval);
+
 private:
     // Clocking is separated into different functions based on the current PPU state
     void clockedHBlank();
@@ -75,6 +92,14 @@ private:
         PIXEL_TRANSFER,
     };
 
+    // Palettes a composed pixel can be mapped through
+    enum PALETTE {
+        BG_PALETTE,
+        OBP0_PALETTE,
+        OBP1_PALETTE,
+        UNLIT_PALETTE, // BG/window disabled -- always displays as UNLIT
+    };
+
     typedef union {
         struct {
             unsigned color : 2;
@@ -94,11 +119,39 @@ private:
     // the length of H_BLANK, so we keep track of it
     uint32_t transfer_cycles;
 
+    // Frame skipping state. skipped_frames counts the frames since the last one drawn
+    uint32_t render_interval;
+    uint32_t skipped_frames;
+    bool draw_frame;
+
+    // Colors of each line as last drawn, and whether any line drawn since the last render differed
+    std::array<std::array<uint8_t, SCREEN_WIDTH>, SCREEN_HEIGHT> previous_lines;
+    bool frame_changed;
+
     std::array<uint8_t, 8 * KB> vram;
     std::array<uint8_t, OAM_SIZE> oam;
 
     std::vector<Pixel> pixel_line;
-    std::vector<Sprite> sprites;
+
+    // Sprites the OAM search found for the current line, kept in drawing priority order
+    std::array<Sprite, MAX_LINE_SPRITES> sprites;
+    uint8_t sprite_count;
+
+    // The composed line. Each pixel is packed as (PALETTE << 2) | color index
+    std::array<uint8_t, SCREEN_WIDTH> line;
+
+    // Maps packed pixels to their final COLOR and ARGB8888 output
+    // Rebuilt whenever a palette register is written
+    std::array<uint8_t, 16> color_lut;
+    std::array<uint32_t, 16> argb_lut;
+
+    // Planar compositor state
+    Plane bg_lo, bg_hi;     // BG/window color index
+    Plane unlit;            // BG/window disabled
+    Plane obj_lo, obj_hi;   // sprite color index
+    Plane obj_mask;         // covered by an opaque sprite pixel
+    Plane obj_pal;          // sprite uses OBP1
+    Plane obj_behind;       // sprite is hidden behind BG colors 1-3
 
     Bus *bus;
     GameboyDriver *driver;
@@ -124,6 +177,9 @@ private:
     PPU_STATUS getStatus();
     void setStatus(PPU_STATUS status);
 
+    // Rebuilds the lookup table entries for palette from its register value
+    void updatePalette(PALETTE palette, uint8_t value);
+
     bool isPPUEnabled();
     bool isWinEnabled();
     bool isBGEnabled();
@@ -133,6 +189,15 @@ private:
 
     void fetchLine();
 
+    // Planar compositor -- builds the line as bitplanes and merges them 64 pixels at a time
+    void composeLine();
+    void fetchBGPlanes();
+    void fetchWinPlanes();
+    void fetchOBJPlanes();
+
+    // Scalar compositor -- builds pixel_line one pixel at a time. Kept as a reference for verification
+    void composeLineScalar();
+
     // Fetches the first num_pixels pixels of the bg for line
     void fetchBG(uint8_t line, uint8_t num_pixels);
 
@@ -142,12 +207,18 @@ private:
     // Overlay sprites onto current line of pixels
     void fetchOBJ(uint8_t line);
 
+    // Packs pixel_line into line
+    void packLine();
+
     void drawLine();
     
     uint16_t getBGTilemapStart();
     uint16_t getWinTilemapStart();
     uint8_t getOBJHeight();
 
+    void fetchTileBytes(uint8_t tile_id, uint8_t tile_line, uint8_t &low_byte, uint8_t &high_byte);
+    void fetchOBJBytes(const Sprite &sprite, uint8_t curr_line, uint8_t &low_byte, uint8_t &high_byte);
+
     void fetchTileLine(uint8_t tile_id, uint8_t tile_line, std::array<Pixel, 8> &out);
     void fetchOBJLine(const Sprite &sprite, uint8_t curr_line, std::array<Pixel, 8> &out);
     void decodePixels(uint8_t low_byte, uint8_t high_byte, std::array<Pixel, 8> &out);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gb_driver.h"
+
+// A recording is a header followed by frame and audio records, in the order they happened.
+// All values are little-endian
+//   header: "GBRC", u16 version, u16 width, u16 height, u32 sample rate
+//   frame:  'F', u8 unlit code, u32 size, size bytes of run-length encoded frame diff.
+//           A size of 0 repeats the previous frame
+//   audio:  'A', u32 count, count stereo samples as interleaved s16
+#define RECORDING_MAGIC "GBRC"
+#define RECORDING_VERSION 1
+
+#define FRAME_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+#define PACKED_FRAME_SIZE (FRAME_PIXELS / 4)
+
+// Frames are packed at 2 bits per pixel, which only fits the four shades. If UNLIT shows up
+// it borrows the code of a shade the frame doesn't use, recorded as the frame's unlit code.
+// A frame using all five colors is stored at a byte per pixel instead
+#define UNLIT_NONE 0xFF
+#define UNLIT_FULL 0xFE
+
+enum RECORD_TYPE {RECORD_FRAME = 'F', RECORD_AUDIO = 'A'};
+
+
+// Encodes each frame as the XOR of it and the previous frame, so unchanged pixels become
+// runs of zeros, then run-length encodes the result
+class FrameEncoder {
+    public:
+        FrameEncoder();
+        ~FrameEncoder() = default;
+
+    public:
+        // Encodes FRAME_PIXELS COLORs into out, returning the frame's unlit code
+        uint8_t encode(const uint8_t *frame, std::vector<uint8_t> &out);
+
+    private:
+        std::array<uint8_t, FRAME_PIXELS> previous;
+        std::vector<uint8_t> current_packed;
+        std::vector<uint8_t> previous_packed;
+};
+
+
+class FrameDecoder {
+    public:
+        FrameDecoder();
+        ~FrameDecoder() = default;
+
+    public:
+        // Decodes a frame written by FrameEncoder. Returns false if the data is corrupt
+        bool decode(const uint8_t *data, uint32_t size, uint8_t unlit_code);
+
+        // Returns FRAME_PIXELS COLORs, row by row
+        const uint8_t *getFrame();
+
+    private:
+        std::array<uint8_t, FRAME_PIXELS> previous;
+        std::vector<uint8_t> diff;
+        std::vector<uint8_t> previous_packed;
+};
+
+
+class RecordingWriter {
+    public:
+        RecordingWriter(const std::string &filename, uint32_t sample_rate);
+        ~RecordingWriter() = default;
+
+    public:
+        void writeFrame(const uint8_t *frame);
+
+        // Writes a zero-size frame record, repeating the previous frame
+        void writeUnchangedFrame();
+        void writeAudio(const int16_t *samples, uint32_t count);
+
+    private:
+        std::ofstream file;
+
+        FrameEncoder encoder;
+        std::vector<uint8_t> encoded;
+};
+
+
+class RecordingReader {
+    public:
+        RecordingReader(const std::string &filename);
+        ~RecordingReader() = default;
+
+    public:
+        uint32_t getSampleRate();
+
+        // Reads the next record, returning false at the end of the recording
+        bool next(RECORD_TYPE &type);
+
+        // The most recently read frame, as FRAME_PIXELS COLORs
+        const uint8_t *getFrame();
+
+        // The most recently read audio, as interleaved stereo samples
+        const std::vector<int16_t> &getAudio();
+
+    private:
+        std::ifstream file;
+        uint32_t sample_rate;
+
+        FrameDecoder decoder;
+        std::vector<uint8_t> encoded;
+        std::vector<int16_t> audio;
+};
\ No newline at end of file
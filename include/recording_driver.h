@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gb_driver.h"
+#include "recording.h"
+
+
+// Wraps another driver, passing everything through while recording every frame and its
+// audio. The emulation thread only hands each frame off; encoding and file writes happen
+// on a background thread
+class RecordingDriver : public GameboyDriver {
+    public:
+        RecordingDriver(GameboyDriver *driver, const std::string &filename);
+        ~RecordingDriver();
+
+    public:
+        void drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) override;
+        void render(bool frame_changed) override;
+        void pushSamples(const float *samples, uint32_t count) override;
+        bool quitReceived() override;
+        ControllerState pollControls() override;
+        double getRateAdjustment() override;
+        uint32_t getRenderInterval() override;
+        uint32_t getARGBColor(COLOR color) override;
+
+    private:
+        // A frame and the audio produced while it was drawn
+        struct Capture {
+            std::array<uint8_t, FRAME_PIXELS> frame;
+            std::vector<int16_t> audio;
+            bool has_frame;
+            bool frame_changed;
+        };
+
+        // Hands the current capture to the writer thread and starts a new one
+        void handOff(bool has_frame, bool frame_changed);
+
+        // Runs on the writer thread until the driver is destroyed
+        void writeLoop();
+
+    private:
+        GameboyDriver *driver;
+        RecordingWriter recording;
+
+        // filled by the emulation thread. Frames skipped by the PPU keep the last drawn one
+        std::unique_ptr<Capture> capture;
+        std::array<uint8_t, FRAME_PIXELS> frame;
+
+        // captures waiting to be written
+        std::deque<std::unique_ptr<Capture>> pending;
+        std::mutex pending_mutex;
+        std::condition_variable pending_cv;
+        bool done;
+
+        std::thread writer;
+};
\ No newline at end of file
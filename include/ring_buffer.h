@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread
+// SIZE must be a power of two
+template <typename T, size_t SIZE>
+class RingBuffer {
+    static_assert(SIZE && !(SIZE & (SIZE - 1)), "RingBuffer size must be a power of two");
+
+    public:
+        RingBuffer() : head(0), tail(0) {}
+
+    public:
+        // Producer side. Returns the number of elements actually written
+        size_t push(const T *src, size_t count) {
+            size_t write = head.load(std::memory_order_relaxed);
+            size_t read = tail.load(std::memory_order_acquire);
+
+            size_t free = SIZE - (write - read);
+            if (count > free) {
+                count = free;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                buffer[(write + i) & (SIZE - 1)] = src[i];
+            }
+
+            head.store(write + count, std::memory_order_release);
+            return count;
+        }
+
+        // Consumer side. Returns the number of elements actually read
+        size_t pop(T *dst, size_t count) {
+            size_t read = tail.load(std::memory_order_relaxed);
+            size_t write = head.load(std::memory_order_acquire);
+
+            size_t available = write - read;
+            if (count > available) {
+                count = available;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                dst[i] = buffer[(read + i) & (SIZE - 1)];
+            }
+
+            tail.store(read + count, std::memory_order_release);
+            return count;
+        }
+
+        // Number of elements waiting to be read. Safe to call from either side
+        size_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        constexpr size_t capacity() const {
+            return SIZE;
+        }
+
+    private:
+        std::array<T, SIZE> buffer;
+
+        // head and tail only ever increase; they're masked on access
+        alignas(64) std::atomic<size_t> head;
+        alignas(64) std::atomic<size_t> tail;
+};
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Scale with plain per-pixel loops instead of SSE and SWAR
+//#define SCALAR_SCALER
+
+// All scalers take a width x height frame of COLOR indices, as drawn by the PPU, and write
+// the scaled frame to out, which must hold (width * factor) x (height * factor) pixels
+
+// Repeats each pixel factor x factor times
+void scaleNearest(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height, uint32_t factor);
+
+// Scale2x (AdvMAME2x): doubles the frame, rounding off diagonal edges instead of leaving stairs
+void scale2x(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height);
+
+// Scale3x (AdvMAME3x): the same edge rules at three times the size
+void scale3x(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height);
\ No newline at end of file
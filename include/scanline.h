@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#define PLANE_WORDS 3
+
+
+// One bit per pixel for a full line, 64 pixels per word
+// Pixel x is bit (63 - x % 64) of word x / 64. This is the same MSB-first order
+// used by tile data, so whole tile rows can be shifted into place at once
+struct Plane {
+    uint64_t w[PLANE_WORDS];
+
+    inline Plane operator&(const Plane &other) const {
+        return {{w[0] & other.w[0], w[1] & other.w[1], w[2] & other.w[2]}};
+    }
+
+    inline Plane operator|(const Plane &other) const {
+        return {{w[0] | other.w[0], w[1] | other.w[1], w[2] | other.w[2]}};
+    }
+
+    inline Plane operator~() const {
+        return {{~w[0], ~w[1], ~w[2]}};
+    }
+
+    inline Plane &operator|=(const Plane &other) {
+        w[0] |= other.w[0];
+        w[1] |= other.w[1];
+        w[2] |= other.w[2];
+        return *this;
+    }
+};
+
+// Builds a plane from PLANE_WORDS * 8 bytes of tile data, dropping the first skip (0-7) pixels
+Plane planeFromBytes(const uint8_t *bytes, uint8_t skip);
+
+// Moves every pixel of the plane right by the given number of pixels
+Plane planeShiftRight(const Plane &plane, uint8_t pixels);
+
+// Returns a plane with pixels [start, end) set
+Plane planeRange(uint8_t start, uint8_t end);
+
+// ORs an 8 pixel row into the plane starting at x. Pixels off either side of the line are dropped
+void planePlaceByte(Plane &plane, int16_t x, uint8_t byte);
+
+// Interleaves four planes into num_pixels bytes, one per pixel (bit n of each byte comes from pn)
+// num_pixels must be a multiple of 8
+void planeUnpack(const Plane &p0, const Plane &p1, const Plane &p2, const Plane &p3,
+                 uint8_t *out, uint8_t num_pixels);
\ No newline at end of file
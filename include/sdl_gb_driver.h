@@ -1,40 +1,115 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <SDL.h>
 
 #include "gb_driver.h"
+#include "ring_buffer.h"
+#include "triple_buffer.h"
 
-#define SAMPLE_SIZE 2048
+// AUDIO_BUFFER_SIZE is in floats (two per stereo sample) and must be a power of two
+#define AUDIO_BUFFER_SIZE 16384
+#define AUDIO_DEVICE_SAMPLES 512
+#define AUDIO_LATENCY_TARGET 40 // ms
+#define RATE_INTEGRAL_GAIN 0.00002
 #define SAMPLE_RATE 48000
-#define SCALE_FACTOR 3
+#define FRAME_DURATION std::chrono::nanoseconds(16742706)
+#define DEFAULT_WINDOW_SCALE 3
+#define DISPLAY_IDLE_DELAY 1 // ms
+
+// Speed multipliers. Unlimited runs the emulator as fast as it can go, without audio
+#define SPEED_UNLIMITED 0.0
+#define MIN_SPEED 0.25
+#define MAX_SPEED 8.0
+
+// Above normal speed only about one frame per FRAME_DURATION is drawn, since the display can't
+// show more. Unlimited speed estimates its frame rate, weighting each new frame by this much
+#define MAX_RENDER_INTERVAL 64
+#define FRAME_TIME_SMOOTHING 0.1
+
+// Hold to run at unlimited speed. The others halve, double and reset the speed multiplier
+#define TURBO_KEY SDL_SCANCODE_TAB
+#define SPEED_DOWN_KEY SDL_SCANCODE_MINUS
+#define SPEED_UP_KEY SDL_SCANCODE_EQUALS
+#define SPEED_RESET_KEY SDL_SCANCODE_0
+
+// How the native resolution frame is stretched to fill the window
+enum SCALE_MODE {SCALE_NEAREST, SCALE_LINEAR};
 
 class SDLGameboyDriver : public GameboyDriver {
     public:
-        SDLGameboyDriver(std::string title);
+        SDLGameboyDriver(std::string title, uint32_t window_scale = DEFAULT_WINDOW_SCALE,
+                         SCALE_MODE scale_mode = SCALE_NEAREST, uint32_t latency_target = AUDIO_LATENCY_TARGET);
         ~SDLGameboyDriver();
 
     public:
-        // Draw a pixel of specified color to the screen at location (x, y)
-        void draw(COLOR color, uint8_t x, uint8_t y) override;
+        // Draw a full line of SCREEN_WIDTH pixels to the screen at row y
+        void drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) override;
 
-        // Render the screen and wait for the rest of the frame
-        void render() override;
+        // Hand the finished frame to the display thread if it changed, and wait for the rest of the frame
+        void render(bool frame_changed) override;
 
-        // Push an audio sample
-        void pushSample(AudioOutput output) override;
+        // Push a block of count stereo samples, interleaved left then right
+        void pushSamples(const float *samples, uint32_t count) override;
 
         // Return true if a QUIT input has been received
         bool quitReceived() override;
 
         // Returns a ControllerState representing currently pressed controls
         ControllerState pollControls() override;
-    
+
+        // Returns the rate adjustment that steers the audio buffer towards the latency target
+        double getRateAdjustment() override;
+
+        // Returns how many frames pass per frame drawn, so fast-forwarded frames the display
+        // would drop anyway aren't composed
+        uint32_t getRenderInterval() override;
+
+        // Hold about ms milliseconds of audio ahead of the device
+        void setLatencyTarget(uint32_t ms);
+
+        // Returns the milliseconds of audio currently buffered ahead of the device
+        double getAudioLatency() const;
+
+        // Returns the number of times the device ran out of audio
+        uint32_t getUnderrunCount() const;
+
+        // Resizes the window to scale times the screen size. Call from the display thread
+        void setWindowScale(uint32_t scale);
+
+        // Switches between nearest and linear filtering. Call from the display thread
+        void setScaleMode(SCALE_MODE mode);
+
+        // Runs the emulator at multiplier times normal speed, from MIN_SPEED up to SPEED_UNLIMITED.
+        // Audio is pitched up or down to match
+        void setSpeed(double multiplier);
+        double getSpeed() const;
+
+        // Presents frames and handles window events on the calling thread until a quit is received.
+        // Must be called from the thread that created the driver, while the emulator runs on another
+        void runDisplay();
+
     private:
-        uint32_t getARGBColor(COLOR color);
+        typedef std::array<uint32_t, SCREEN_WIDTH * SCREEN_HEIGHT> Frame;
+
+        // Uploads a frame to the texture and lets the renderer scale it to the window
+        void presentFrame(const Frame &frame);
+
+        // Picks up quit events and the current keyboard state
+        void handleEvents();
+
+        // The speed multiplier in effect, taking turbo into account
+        double getEffectiveSpeed() const;
+
+        // Called from SDL's audio thread to drain the ring buffer
+        static void audioCallback(void *userdata, uint8_t *stream, int len);
 
     private:
         SDL_Renderer *renderer;
@@ -43,11 +118,42 @@ class SDLGameboyDriver : public GameboyDriver {
         SDL_Event event;
 
         const uint8_t *keyboard_state;
-        uint32_t *pixels;
+
+        // frames drawn by the emulator thread, picked up by the display thread
+        TripleBuffer<Frame> frames;
+
+        // set by window events, which can lose what's on screen while no new frames arrive
+        bool redraw;
+
+        // written by the display thread, read by the emulator thread
+        std::atomic<uint8_t> controls;
+        std::atomic<bool> quit_requested;
+        std::atomic<bool> turbo;
+        std::atomic<double> speed;
 
         uint8_t audio_device_id;
-        uint32_t samples_stored;
-        std::array<float, SAMPLE_SIZE> samples;
+        RingBuffer<float, AUDIO_BUFFER_SIZE> samples;
+
+        // latency_target is in floats. The audio thread waits for it to be buffered before playing
+        std::atomic<size_t> latency_target;
+        std::atomic<uint32_t> underruns;
+        double rate_adjustment;
+        double rate_integral;
+        std::atomic<bool> primed;
 
+        // set while running unlimited, when no audio is pushed and the rate isn't steered
+        bool ran_unlimited;
+
+        // off-speed audio is resampled by stepping through blocks at the speed multiplier.
+        // resample_position carries the fractional step over to the next block
+        std::vector<float> resampled;
+        std::array<float, 2> previous_sample;
+        double resample_position;
+
+        // when the current frame is due to end
         std::chrono::steady_clock::time_point time;
+
+        // seconds each frame takes to emulate at unlimited speed, and the render interval it gives
+        double frame_time;
+        uint32_t render_interval;
 };
\ No newline at end of file
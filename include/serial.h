@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define SB 0xFF01 // serial bus
+#define SC 0xFF02 // serial control
+
+// The internal clock shifts a bit out every 512 cycles (8192 Hz), a byte every 4096
+#define SERIAL_BIT_CYCLES 512
+#define SERIAL_TRANSFER_CYCLES (8 * SERIAL_BIT_CYCLES)
+
+// Returned by getCyclesUntilTransfer when no transfer is clocking
+#define SERIAL_NO_TRANSFER UINT32_MAX
+
+class Bus;
+
+
+class Serial {
+    public:
+        Serial();
+        ~Serial() = default;
+
+    public:
+        void clock(uint8_t cycles);
+        void reset();
+
+        // Returns true if a r/w to addr is handled by the serial port
+        bool regWrite(uint16_t addr, uint8_t data);
+        bool regRead(uint16_t addr, uint8_t &val);
+
+        void connectBus(Bus *bus);
+
+        // With a link attached, a transfer on the internal clock stops once its last bit is
+        // shifted and waits for the link to exchange bytes. Without one, 0xFF is shifted in
+        void setLinked(bool linked);
+
+        // Keep every byte sent on the internal clock, which is how test ROMs report results
+        void setCaptureEnabled(bool enabled);
+        const std::vector<uint8_t> &getCapturedOutput();
+
+        // Cycles until an internally clocked transfer shifts its last bit
+        uint32_t getCyclesUntilTransfer();
+
+        // True once an internally clocked transfer is waiting for the other side's byte
+        bool isTransferDue();
+
+        // The byte being shifted out
+        uint8_t getOutgoing();
+
+        // Finishes a due transfer with the byte the other side shifted out
+        void completeTransfer(uint8_t incoming);
+
+        // Called when the other side's clock shifts a byte in. Returns the byte shifted out,
+        // or 0xFF if no externally clocked transfer is waiting
+        uint8_t receiveExternal(uint8_t incoming);
+
+    private:
+        bool isClockingInternally();
+
+        uint8_t sb;
+        uint8_t sc;
+
+        uint32_t transfer_cycles;
+        bool linked;
+
+        bool capture_enabled;
+        std::vector<uint8_t> captured_output;
+        Bus *bus;
+};
\ No newline at end of file
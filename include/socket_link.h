@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "bus.h"
+
+// How far a machine may run past the last time it heard from the other side. Up to
+// SERIAL_TRANSFER_CYCLES every byte is swapped at the exact cycle, since a transfer is
+// announced when it starts and takes that long to finish. Larger windows stall less on a
+// slow peer, but a transfer that arrives after its finish is handled late
+#define DEFAULT_LINK_WINDOW SERIAL_TRANSFER_CYCLES
+
+enum LINK_ROLE {LINK_LISTEN, LINK_CONNECT};
+
+
+// Links the serial port of a machine to one in another process. Addresses starting with
+// "unix:" name a Unix domain socket, anything else is a TCP "host:port".
+//
+// Each side streams its cycle count as it runs and announces transfers when SC starts
+// them, again when SC restarts them, and cancels them when SC stops them. The only round
+// trip is the reply to a transfer, which the other side sends once both sides have reached
+// the finish, so neither side waits on the other per instruction
+class SocketLink {
+    public:
+        // Listening blocks until the other side connects
+        SocketLink(Bus *bus, LINK_ROLE role, const std::string &address, uint32_t window = DEFAULT_LINK_WINDOW);
+        ~SocketLink();
+
+    public:
+        // Run the machine until it quits. If the other side goes away the cable is
+        // unplugged and the machine carries on alone
+        void run();
+
+        // Bytes exchanged so far, from transfers on either clock
+        uint64_t getTransferCount();
+
+    private:
+        enum MESSAGE {MESSAGE_TIME, MESSAGE_TRANSFER, MESSAGE_CANCEL, MESSAGE_REPLY};
+
+        struct Message {
+            MESSAGE type;
+            uint8_t data;
+            uint64_t time;
+        };
+
+        // A transfer the other side started, finishing at time
+        struct Transfer {
+            uint64_t time;
+            uint8_t data;
+        };
+
+        void send(MESSAGE type, uint8_t data, uint64_t time);
+
+        // Handle messages from the other side. Blocks until one arrives if wait is set,
+        // returning false once the other side has gone
+        bool receive(bool wait);
+
+        // Answer the other side's transfer if it has finished by now
+        void answerTransfer();
+
+        // Tell the other side when our transfer starts, moves or stops
+        void announceTransfer();
+
+        // Waits for the other side's byte and finishes our own transfer
+        void finishTransfer();
+
+        void disconnect();
+
+        Bus *bus;
+        int fd;
+        uint32_t window;
+
+        uint64_t time;
+        uint64_t peer_time;
+
+        // The other side has at most one transfer going. A new announcement replaces it
+        Transfer peer_transfer;
+        bool peer_transferring;
+
+        // Our transfer's finish as last announced. Replies are matched against it, so one
+        // meant for a transfer that has since been restarted or cancelled is dropped
+        uint64_t announced_time;
+        bool announced;
+        bool replied;
+        uint8_t reply;
+
+        uint64_t transfer_count;
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for exactly one writer thread and one reader thread.
+// The writer always has a buffer to fill and the reader always has the newest
+// complete one, so neither side ever waits on the other
+template <typename T>
+class TripleBuffer {
+    public:
+        TripleBuffer() : back(0), middle(1), front(2) {}
+
+    public:
+        // Writer side. The buffer to fill with the next value
+        T &getWriteBuffer() {
+            return buffers[back];
+        }
+
+        // Writer side. Hands the filled buffer over to the reader, replacing any it hasn't picked up
+        void publish() {
+            uint8_t old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+            back = old & INDEX_MASK;
+        }
+
+        // Reader side. Picks up the newest published buffer, returning false if there isn't a new one
+        bool acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+                return false;
+            }
+
+            uint8_t old = middle.exchange(front, std::memory_order_acq_rel);
+            front = old & INDEX_MASK;
+            return true;
+        }
+
+        // Reader side. The most recently acquired buffer
+        const T &getReadBuffer() const {
+            return buffers[front];
+        }
+
+    private:
+        // middle holds a buffer index, with FRESH set while it's waiting for the reader
+        static constexpr uint8_t INDEX_MASK = 0x03;
+        static constexpr uint8_t FRESH = 0x04;
+
+        std::array<T, 3> buffers;
+
+        // back is only touched by the writer and front only by the reader
+        alignas(64) uint8_t back;
+        alignas(64) std::atomic<uint8_t> middle;
+        alignas(64) uint8_t front;
+};
\ No newline at end of file
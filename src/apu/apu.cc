@@ -1,12 +1,20 @@
 #include <algorithm>
+#include <cmath>
 
 #include "apu/apu.h"
-#include "audio_output.h"
+#include "apu/mixer.h"
 
-APU::APU(GameboyDriver *driver) {
+APU::APU(GameboyDriver *driver) : blips{{BlipBuffer(AUDIO_BLOCK_SIZE), BlipBuffer(AUDIO_BLOCK_SIZE),
+                                         BlipBuffer(AUDIO_BLOCK_SIZE), BlipBuffer(AUDIO_BLOCK_SIZE)}} {
     this->driver = driver;
     duty_cycles = {0xF0, 0x81, 0xE1, 0x7E};
-    sample_frequency = GB_CLOCK_RATE / this->driver->sampling_rate;
+    audio_enabled = true;
+
+    // leave room for the fraction of a sample carried between blocks, at the highest rate we'll run at
+    block_clocks = (AUDIO_BLOCK_SIZE - 1) * GB_CLOCK_RATE / (this->driver->sampling_rate * (1 + MAX_RATE_ADJUSTMENT));
+
+    output_rate = 0;
+    updateOutputRate();
 
     reset();
 }
@@ -22,91 +30,181 @@ void APU::reset() {
     ch3.reset();
     ch4.reset();
 
-    clocks_to_sample = 0;
+    pending_clocks = 0;
+    sequencer_timer = SEQUENCER_CLOCKS;
+    sequencer_step = 0;
+    amplitudes.fill(0);
+
+    for (BlipBuffer &blip : blips) {
+        blip.clear();
+    }
 }
 
 void APU::clock(uint8_t clocks) {
-    if (isAPUEnabled()) {
-        // perform as many clocks as possible at each step until we need to provide a sample
-        while (clocks >= clocks_to_sample) {
-            AudioOutput output = {};
-
-            ch1.clock(clocks_to_sample);
-            ch2.clock(clocks_to_sample);
-            ch3.clock(clocks_to_sample);
-            ch4.clock(clocks_to_sample);
-
-            clocks -= clocks_to_sample;
-            clocks_to_sample = sample_frequency;
-
-            // mix channel 1
-            if (ch1.isEnabled()) {
-                uint8_t ch1_output = ch1.getOutput();
-
-                // output left
-                if (nr51 & 0x10) {
-                    output.ch1_left = ch1_output * getLeftVolume();
-                }
-                // output right
-                if (nr51 & 0x01) {
-                    output.ch1_right = ch1_output * getRightVolume();
-                }
-            }
-
-            // mix channel 2
-            if (ch2.isEnabled()) {
-                uint8_t ch2_output = ch2.getOutput();
-
-                // output left
-                if (nr51 & 0x20) {
-                    output.ch2_left = ch2_output * getLeftVolume();
-                }
-                // output right
-                if (nr51 & 0x02) {
-                    output.ch2_right = ch2_output * getRightVolume();
-                }
-            }
-
-            // mix channel 3
-            if (ch3.isEnabled()) {
-                uint8_t ch3_output = ch3.getOutput();
-
-                // output left
-                if (nr51 & 0x04) {
-                    output.ch3_left = ch3_output * getLeftVolume();
-                }
-                // output right
-                if (nr51 & 0x40) {
-                    output.ch3_right = ch3_output * getRightVolume();
-                }
-            }
-
-            // mix channel 4
-            if (ch4.isEnabled()) {
-                uint8_t ch4_output = ch4.getOutput();
-
-                // output left
-                if (nr51 & 0x08) {
-                    output.ch4_left = ch4_output * getLeftVolume();
-                }
-                // output right
-                if (nr51 & 0x80) {
-                    output.ch4_right = ch4_output * getRightVolume();
-                }
-            }
-
-            driver->pushSample(output);
+    // synthesis is deferred until a register is accessed or a full block is due
+    pending_clocks += clocks;
+
+    if (pending_clocks >= (audio_enabled ? block_clocks : SILENT_FLUSH_CLOCKS)) {
+        flush();
+    }
+}
+
+void APU::flush() {
+    if (!isAPUEnabled()) {
+        pending_clocks = 0;
+        return;
+    }
+
+    if (!audio_enabled) {
+        advanceSilently(pending_clocks);
+        pending_clocks = 0;
+        return;
+    }
+
+    while (pending_clocks) {
+        uint32_t clocks = std::min(pending_clocks, block_clocks);
+        pending_clocks -= clocks;
+
+        updateOutputRate();
+
+        uint32_t num_samples = synthesize(clocks);
+        if (num_samples) {
+            driver->pushSamples(block.data(), num_samples);
+        }
+    }
+}
+
+void APU::setAudioEnabled(bool enabled) {
+    // pending clocks belong to the old mode
+    flush();
+    audio_enabled = enabled;
+}
+
+void APU::updateOutputRate() {
+    double adjustment = std::clamp(driver->getRateAdjustment(), 1 - MAX_RATE_ADJUSTMENT, 1 + MAX_RATE_ADJUSTMENT);
+    uint32_t rate = std::lround(driver->sampling_rate * adjustment);
+
+    if (rate != output_rate) {
+        output_rate = rate;
+
+        for (BlipBuffer &blip : blips) {
+            blip.setRates(GB_CLOCK_RATE, output_rate);
         }
+    }
+}
 
-        // apply remaining clocks
-        ch1.clock(clocks);
-        ch2.clock(clocks);
-        ch3.clock(clocks);
-        ch4.clock(clocks);
-        clocks_to_sample -= clocks;
+void APU::advanceSilently(uint32_t clocks) {
+    // the waveforms aren't heard, so only the sequencer's steps matter
+    while (clocks) {
+        uint32_t step = std::min(clocks, sequencer_timer);
+        sequencer_timer -= step;
+        clocks -= step;
+
+        if (!sequencer_timer) {
+            stepSequencer();
+        }
     }
 }
 
+void APU::stepSequencer() {
+    // length counters step at 256 Hz, sweep at 128 Hz and envelopes at 64 Hz
+    if (!(sequencer_step & 0x01)) {
+        ch1.stepLength();
+        ch2.stepLength();
+        ch3.stepLength();
+        ch4.stepLength();
+    }
+
+    if (sequencer_step == 2 || sequencer_step == 6) {
+        ch1.stepSweep();
+    }
+
+    if (sequencer_step == 7) {
+        ch1.stepEnvelope();
+        ch2.stepEnvelope();
+        ch4.stepEnvelope();
+    }
+
+    sequencer_step = (sequencer_step + 1) % 8;
+    sequencer_timer = SEQUENCER_CLOCKS;
+}
+
+uint32_t APU::synthesize(uint32_t clocks) {
+    uint32_t time = 0;
+    while (time < clocks) {
+        // between sequencer steps the channels only change on their own waveform edges
+        uint32_t end = std::min(clocks, time + sequencer_timer);
+
+        synthesizeChannel(ch1, 0, time, end);
+        synthesizeChannel(ch2, 1, time, end);
+        synthesizeChannel(ch3, 2, time, end);
+        synthesizeChannel(ch4, 3, time, end);
+
+        sequencer_timer -= end - time;
+        time = end;
+
+        if (!sequencer_timer) {
+            stepSequencer();
+
+            updateAmplitude(ch1, 0, time);
+            updateAmplitude(ch2, 1, time);
+            updateAmplitude(ch3, 2, time);
+            updateAmplitude(ch4, 3, time);
+        }
+    }
+
+    for (BlipBuffer &blip : blips) {
+        blip.endBlock(clocks);
+    }
+
+    uint32_t num_samples = blips[0].samplesAvailable();
+    for (uint8_t i = 0; i < 4; i++) {
+        blips[i].readSamples(channel_samples[i].data(), num_samples);
+    }
+
+    mix(num_samples);
+    return num_samples;
+}
+
+template <typename T>
+void APU::synthesizeChannel(T &ch, uint8_t index, uint32_t start, uint32_t end) {
+    uint32_t time = start;
+    while (time < end) {
+        uint32_t step = std::min(ch.getClocksUntilStep(), end - time);
+        step = std::max(step, (uint32_t) 1);
+
+        ch.clock(step);
+        time += step;
+
+        updateAmplitude(ch, index, time);
+    }
+}
+
+template <typename T>
+void APU::updateAmplitude(T &ch, uint8_t index, uint32_t time) {
+    int16_t output = (ch.isEnabled() ? ch.getOutput() : 0) * AMPLITUDE_SCALE;
+    if (output != amplitudes[index]) {
+        blips[index].addDelta(time, output - amplitudes[index]);
+        amplitudes[index] = output;
+    }
+}
+
+void APU::mix(uint32_t num_samples) {
+    std::array<float, 4> left_gain;
+    std::array<float, 4> right_gain;
+
+    // NR51 routes channel i to the left output with bit 4 + i and to the right with bit i
+    for (uint8_t i = 0; i < 4; i++) {
+        left_gain[i] = ((nr51 >> (4 + i)) & 0x01) * (getLeftVolume() + 1) * MIX_SCALE;
+        right_gain[i] = ((nr51 >> i) & 0x01) * (getRightVolume() + 1) * MIX_SCALE;
+    }
+
+    const int16_t *channels[4] = {channel_samples[0].data(), channel_samples[1].data(),
+                                  channel_samples[2].data(), channel_samples[3].data()};
+
+    mixChannels(channels, left_gain.data(), right_gain.data(), block.data(), num_samples);
+}
+
 bool APU::isAPUEnabled() {
     return nr52 & 0x80;
 }
@@ -120,6 +218,13 @@ uint8_t APU::getRightVolume() {
 }
 
 bool APU::regWrite(uint16_t addr, uint8_t data) {
+    if (addr < NR10 || addr >= WAVE_PATTERN_END) {
+        return false;
+    }
+
+    // the write takes effect at the current cycle, so catch up to it first
+    flush();
+
     if (ch1.regWrite(addr, data)) {
         return true;
     }
@@ -144,6 +249,13 @@ bool APU::regWrite(uint16_t addr, uint8_t data) {
 }
 
 bool APU::regRead(uint16_t addr, uint8_t &val) {
+    if (addr < NR10 || addr >= WAVE_PATTERN_END) {
+        return false;
+    }
+
+    // status bits depend on channel state up to the current cycle
+    flush();
+
     if (ch1.regRead(addr, val)) {
         return true;
     }
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "apu/blip_buffer.h"
+
+typedef std::array<std::array<int16_t, BLIP_WIDTH>, BLIP_PHASES> BlipKernel;
+
+// Builds a windowed-sinc impulse for each sub-sample phase. Summed up, each
+// impulse gives a step that is free of content above the output's nyquist rate
+static BlipKernel makeKernel() {
+    const double cutoff = 0.9;
+    const double half_width = BLIP_WIDTH / 2;
+    BlipKernel kernel;
+
+    for (uint32_t phase = 0; phase < BLIP_PHASES; phase++) {
+        std::array<double, BLIP_WIDTH> taps;
+        double sum = 0;
+
+        double center = half_width - 1 + (double) phase / BLIP_PHASES;
+        for (uint32_t i = 0; i < BLIP_WIDTH; i++) {
+            double d = i - center;
+            double x = M_PI * cutoff * d;
+            double sinc = (x == 0) ? 1 : std::sin(x) / x;
+            double window = 0.42 + 0.5 * std::cos(M_PI * d / half_width) + 0.08 * std::cos(2 * M_PI * d / half_width);
+
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        // normalize so every phase adds up to exactly one step, putting rounding error on the peak
+        int32_t total = 0;
+        uint32_t peak = 0;
+        for (uint32_t i = 0; i < BLIP_WIDTH; i++) {
+            kernel[phase][i] = std::lround(taps[i] / sum * (1 << BLIP_DELTA_BITS));
+            total += kernel[phase][i];
+
+            if (kernel[phase][i] > kernel[phase][peak]) {
+                peak = i;
+            }
+        }
+        kernel[phase][peak] += (1 << BLIP_DELTA_BITS) - total;
+    }
+
+    return kernel;
+}
+
+BlipBuffer::BlipBuffer(uint32_t max_samples) {
+    buffer.resize(max_samples + BLIP_WIDTH);
+    factor = 0;
+
+    clear();
+}
+
+void BlipBuffer::setRates(uint32_t clock_rate, uint32_t sample_rate) {
+    factor = ((uint64_t) sample_rate << BLIP_FRAC_BITS) / clock_rate;
+}
+
+void BlipBuffer::clear() {
+    offset = 0;
+    integrator = 0;
+    std::fill(buffer.begin(), buffer.end(), 0);
+}
+
+void BlipBuffer::addDelta(uint32_t time, int32_t delta) {
+    static const BlipKernel kernel = makeKernel();
+
+    uint64_t position = offset + time * factor;
+    uint32_t phase = (position >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+
+    int32_t *out = &buffer[position >> BLIP_FRAC_BITS];
+    for (uint32_t i = 0; i < BLIP_WIDTH; i++) {
+        out[i] += kernel[phase][i] * delta;
+    }
+}
+
+void BlipBuffer::endBlock(uint32_t clocks) {
+    offset += clocks * factor;
+}
+
+uint32_t BlipBuffer::samplesAvailable() {
+    return offset >> BLIP_FRAC_BITS;
+}
+
+uint32_t BlipBuffer::readSamples(int16_t *out, uint32_t count) {
+    count = std::min(count, samplesAvailable());
+
+    int32_t sum = integrator;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t sample = sum >> BLIP_DELTA_BITS;
+        sum += buffer[i];
+
+        out[i] = std::clamp(sample, (int32_t) INT16_MIN, (int32_t) INT16_MAX);
+
+        // slowly pull the output back towards zero to remove any DC offset
+        sum -= sample << (BLIP_DELTA_BITS - BLIP_BASS_SHIFT);
+    }
+    integrator = sum;
+
+    // shift the unread samples and the kernel tails spilling past them to the front
+    uint32_t remaining = samplesAvailable() - count + BLIP_WIDTH;
+    std::copy(buffer.begin() + count, buffer.begin() + count + remaining, buffer.begin());
+    std::fill(buffer.begin() + remaining, buffer.begin() + remaining + count, 0);
+    offset -= (uint64_t) count << BLIP_FRAC_BITS;
+
+    return count;
+}
\ No newline at end of file
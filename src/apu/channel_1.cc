@@ -40,18 +40,18 @@ void Channel1::reset() {
     nr10 = 0x80;
     nr11 = 0xBF;
     nr12 = 0xF3;
+    nr13 = 0xFF;
     nr14 = 0xBF;
 
     duty_pointer = 0;
     duty_timer = SQUARE_FREQ_TO_PERIOD(getFrequency());
     enabled = true;
 
-    len_counter.reset();
     freq_sweep.reset();
     envelope.reset();
 }
 
-void Channel1::clock(uint8_t clocks) {
+void Channel1::clock(uint32_t clocks) {
     uint32_t period = SQUARE_FREQ_TO_PERIOD(getFrequency());
     if (clocks >= duty_timer) {
         duty_pointer += 1 + ((clocks - duty_timer) / period);
@@ -61,16 +61,28 @@ void Channel1::clock(uint8_t clocks) {
     } else {
         duty_timer -= clocks;
     }
+}
+
+void Channel1::stepLength() {
+    len_counter.step();
+}
 
-    len_counter.clock(clocks);
-    freq_sweep.clock(clocks);
-    envelope.clock(clocks);
+void Channel1::stepSweep() {
+    freq_sweep.step();
+}
+
+void Channel1::stepEnvelope() {
+    envelope.step();
 }
 
 uint8_t Channel1::getOutput() {
     return ((duty_cycles[getDuty()] >> duty_pointer) & 0x01) * envelope.getVolume();
 }
 
+uint32_t Channel1::getClocksUntilStep() {
+    return duty_timer;
+}
+
 bool Channel1::isEnabled() {
     return enabled;
 }
@@ -37,17 +37,17 @@ bool Channel2::regWrite(uint16_t addr, uint8_t data) {
 void Channel2::reset() {
     nr21 = 0xBF;
     nr22 = 0xF3;
+    nr23 = 0xFF;
     nr24 = 0xBF;
 
     duty_pointer = 0;
     duty_timer = SQUARE_FREQ_TO_PERIOD(getFrequency());
     enabled = true;
 
-    len_counter.reset();
     envelope.reset();
 }
 
-void Channel2::clock(uint8_t clocks) {
+void Channel2::clock(uint32_t clocks) {
     uint32_t period = SQUARE_FREQ_TO_PERIOD(getFrequency());
     if (clocks >= duty_timer) {
         duty_pointer += 1 + ((clocks - duty_timer) / period);
@@ -57,15 +57,24 @@ void Channel2::clock(uint8_t clocks) {
     } else {
         duty_timer -= clocks;
     }
+}
+
+void Channel2::stepLength() {
+    len_counter.step();
+}
 
-    len_counter.clock(clocks);
-    envelope.clock(clocks);
+void Channel2::stepEnvelope() {
+    envelope.step();
 }
 
 uint8_t Channel2::getOutput() {
     return ((duty_cycles[getDuty()] >> duty_pointer) & 0x01) * envelope.getVolume();
 }
 
+uint32_t Channel2::getClocksUntilStep() {
+    return duty_timer;
+}
+
 bool Channel2::isEnabled() {
     return enabled;
 }
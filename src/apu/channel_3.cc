@@ -3,6 +3,9 @@
 #include "apu/channel_3.h"
 
 Channel3::Channel3() : len_counter(this) {
+    // wave RAM keeps its contents across resets, so it's only cleared here
+    wave_pattern_ram.fill(0);
+
 	reset();
 }
 
@@ -50,16 +53,15 @@ void Channel3::reset() {
     nr31 = 0xFF;
     nr32 = 0x9F;
     nr33 = 0xBF;
+    nr34 = 0xBF;
 
     table_timer = WAVE_FREQ_TO_PERIOD(getFrequency());
     table_pointer = 0;
     sample = wave_pattern_ram[0];
     enabled = true;
-
-    len_counter.reset();
 }
 
-void Channel3::clock(uint8_t clocks) {
+void Channel3::clock(uint32_t clocks) {
     uint32_t period = WAVE_FREQ_TO_PERIOD(getFrequency());
     if (clocks >= table_timer) {
         table_pointer += 1 + ((clocks - table_timer) / period);
@@ -70,8 +72,10 @@ void Channel3::clock(uint8_t clocks) {
     } else {
         table_timer -= clocks;
     }
+}
 
-    len_counter.clock(clocks);
+void Channel3::stepLength() {
+    len_counter.step();
 }
 
 uint8_t Channel3::getOutput() {
@@ -105,6 +109,10 @@ uint8_t Channel3::getOutput() {
     return output;
 }
 
+uint32_t Channel3::getClocksUntilStep() {
+    return table_timer;
+}
+
 bool Channel3::isEnabled() {
     return enabled;
 }
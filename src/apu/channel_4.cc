@@ -1,6 +1,52 @@
+#include <array>
+
 #include "apu/apu_addrs.h"
 #include "apu/channel_4.h"
 
+// Every state of the 15 and 7 bit LFSRs in the order they're stepped through,
+// and each state's position in that order
+struct LFSRTables {
+    std::array<uint16_t, LFSR15_PERIOD> states15;
+    std::array<uint16_t, 0x8000> index15;
+    std::array<uint8_t, LFSR7_PERIOD> states7;
+    std::array<uint8_t, 0x80> index7;
+};
+
+static uint16_t stepLFSR(uint16_t lfsr, bool width_mode) {
+    uint8_t xor_result = (lfsr & 0x0001) ^ ((lfsr & 0x0002) >> 1);
+    lfsr >>= 1;
+    lfsr |= xor_result << 14;
+
+    if (width_mode) {
+        lfsr &= 0x003F;
+        lfsr |= xor_result << 6;
+    }
+
+    return lfsr;
+}
+
+static LFSRTables buildLFSRTables() {
+    LFSRTables tables = {};
+
+    uint16_t lfsr = 0x7FFF;
+    for (uint16_t i = 0; i < LFSR15_PERIOD; i++) {
+        tables.states15[i] = lfsr;
+        tables.index15[lfsr] = i;
+        lfsr = stepLFSR(lfsr, false);
+    }
+
+    lfsr = 0x7F;
+    for (uint8_t i = 0; i < LFSR7_PERIOD; i++) {
+        tables.states7[i] = lfsr;
+        tables.index7[lfsr] = i;
+        lfsr = stepLFSR(lfsr, true);
+    }
+
+    return tables;
+}
+
+static const LFSRTables lfsr_tables = buildLFSRTables();
+
 Channel4::Channel4() : len_counter(this), envelope(this) {
     divisors = {8, 16, 32, 48, 64, 80, 96, 112};
 
@@ -35,40 +81,46 @@ bool Channel4::regWrite(uint16_t addr, uint8_t data) {
 }
 
 void Channel4::reset() {
+    nr41 = 0xFF;
+    nr42 = 0x00;
+    nr43 = 0x00;
+    nr44 = 0xBF;
+
     enabled = true;
 
     timer = getDivisor() << getClockShift();
     lfsr = 0x7FFF;
 
-    len_counter.reset();
     envelope.reset();
 }
 
-void Channel4::clock(uint8_t clocks) {
+void Channel4::clock(uint32_t clocks) {
     uint32_t period = getDivisor() << getClockShift();
     if (clocks >= timer) {
-        uint8_t xor_result = (lfsr & 0x0001) ^ ((lfsr & 0x0002) >> 1);
-        lfsr >>= 1;
-        lfsr |= xor_result << 14;
-
-        if (isWidthModeEnabled()) {
-            lfsr &= 0x003F;
-            lfsr |= xor_result << 6;
-        }
+        advanceLFSR(1 + (clocks - timer) / period);
 
         timer = period - ((clocks - timer) % period);
     } else {
         timer -= clocks;
     }
+}
+
+void Channel4::stepLength() {
+    len_counter.step();
+}
 
-    len_counter.clock(clocks);
-    envelope.clock(clocks);
+void Channel4::stepEnvelope() {
+    envelope.step();
 }
 
 uint8_t Channel4::getOutput() {
     return ((~lfsr) & 0x0001) * envelope.getVolume();
 }
 
+uint32_t Channel4::getClocksUntilStep() {
+    return timer;
+}
+
 bool Channel4::isEnabled() {
     return enabled;
 }
@@ -119,6 +171,16 @@ void Channel4::trigger() {
     envelope.trigger();
 }
 
+void Channel4::advanceLFSR(uint32_t steps) {
+    if (isWidthModeEnabled()) {
+        // in 7 bit mode the next state only depends on the low 7 bits, and clearing them stalls the LFSR
+        uint8_t low = lfsr & 0x7F;
+        lfsr = low ? lfsr_tables.states7[(lfsr_tables.index7[low] + steps) % LFSR7_PERIOD] : 0;
+    } else if (lfsr) {
+        lfsr = lfsr_tables.states15[(lfsr_tables.index15[lfsr] + steps) % LFSR15_PERIOD];
+    }
+}
+
 uint8_t Channel4::getClockShift() {
     return (nr43 & 0xF0) >> 4;
 }
@@ -0,0 +1,60 @@
+#if defined(__SSE2__) && !defined(SCALAR_MIXER)
+#include <emmintrin.h>
+#endif
+
+#include "apu/mixer.h"
+
+void mixChannels(const int16_t *const *channels, const float *left_gain, const float *right_gain,
+                 float *out, uint32_t num_samples) {
+    uint32_t i = 0;
+
+#if defined(__SSE2__) && !defined(SCALAR_MIXER)
+    __m128 left_gains[4];
+    __m128 right_gains[4];
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        left_gains[ch] = _mm_set1_ps(left_gain[ch]);
+        right_gains[ch] = _mm_set1_ps(right_gain[ch]);
+    }
+
+    // 8 samples per pass: each channel's int16s are widened to two vectors of 4 floats
+    for (; i + 8 <= num_samples; i += 8) {
+        __m128 left_lo = _mm_setzero_ps();
+        __m128 left_hi = _mm_setzero_ps();
+        __m128 right_lo = _mm_setzero_ps();
+        __m128 right_hi = _mm_setzero_ps();
+
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            __m128i samples = _mm_loadu_si128((const __m128i *) &channels[ch][i]);
+
+            // sign extend by unpacking into the high halves and shifting back down
+            __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+            __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+
+            left_lo = _mm_add_ps(left_lo, _mm_mul_ps(lo, left_gains[ch]));
+            left_hi = _mm_add_ps(left_hi, _mm_mul_ps(hi, left_gains[ch]));
+            right_lo = _mm_add_ps(right_lo, _mm_mul_ps(lo, right_gains[ch]));
+            right_hi = _mm_add_ps(right_hi, _mm_mul_ps(hi, right_gains[ch]));
+        }
+
+        // interleave into L R L R ...
+        _mm_storeu_ps(&out[i * 2 + 0], _mm_unpacklo_ps(left_lo, right_lo));
+        _mm_storeu_ps(&out[i * 2 + 4], _mm_unpackhi_ps(left_lo, right_lo));
+        _mm_storeu_ps(&out[i * 2 + 8], _mm_unpacklo_ps(left_hi, right_hi));
+        _mm_storeu_ps(&out[i * 2 + 12], _mm_unpackhi_ps(left_hi, right_hi));
+    }
+#endif
+
+    // whatever doesn't fill a full vector
+    for (; i < num_samples; i++) {
+        float left = 0;
+        float right = 0;
+
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            left += channels[ch][i] * left_gain[ch];
+            right += channels[ch][i] * right_gain[ch];
+        }
+
+        out[i * 2] = left;
+        out[i * 2 + 1] = right;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "audio_capture_driver.h"
+
+AudioCaptureDriver::AudioCaptureDriver(GameboyDriver *driver, const std::string &filename, CAPTURE_FORMAT format)
+    : GameboyDriver(driver->sampling_rate), file(filename, std::ios::binary) {
+    if (!file) {
+        throw std::runtime_error("Unable to open audio capture file " + filename + ".");
+    }
+
+    this->driver = driver;
+    this->format = format;
+
+    // the header's sizes are filled in once we know them
+    if (format == CAPTURE_WAV) {
+        writeHeader(0);
+    }
+
+    chunk.reserve(CAPTURE_CHUNK_SIZE);
+    data_size = 0;
+    done = false;
+    quit = false;
+
+    writer = std::thread(&AudioCaptureDriver::writeLoop, this);
+}
+
+AudioCaptureDriver::~AudioCaptureDriver() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if (!chunk.empty()) {
+            pending.push_back(std::move(chunk));
+        }
+
+        done = true;
+    }
+
+    pending_cv.notify_one();
+    writer.join();
+
+    if (format == CAPTURE_WAV) {
+        file.seekp(0);
+        writeHeader((uint32_t) data_size);
+    }
+}
+
+void AudioCaptureDriver::drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) {
+    driver->drawLine(colors, argb, y);
+}
+
+void AudioCaptureDriver::render(bool frame_changed) {
+    driver->render(frame_changed);
+}
+
+void AudioCaptureDriver::pushSamples(const float *samples, uint32_t count) {
+    for (uint32_t i = 0; i < count * 2; i++) {
+        float sample = std::clamp(samples[i], -1.0F, 1.0F);
+        chunk.push_back(std::lround(sample * INT16_MAX));
+
+        if (chunk.size() == CAPTURE_CHUNK_SIZE) {
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                pending.push_back(std::move(chunk));
+            }
+
+            pending_cv.notify_one();
+
+            chunk = std::vector<int16_t>();
+            chunk.reserve(CAPTURE_CHUNK_SIZE);
+        }
+    }
+
+    driver->pushSamples(samples, count);
+}
+
+bool AudioCaptureDriver::quitReceived() {
+    return driver->quitReceived();
+}
+
+ControllerState AudioCaptureDriver::pollControls() {
+    return driver->pollControls();
+}
+
+double AudioCaptureDriver::getRateAdjustment() {
+    return driver->getRateAdjustment();
+}
+
+uint32_t AudioCaptureDriver::getRenderInterval() {
+    return driver->getRenderInterval();
+}
+
+uint32_t AudioCaptureDriver::getARGBColor(COLOR color) {
+    return driver->getARGBColor(color);
+}
+
+void AudioCaptureDriver::writeLoop() {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+
+    while (true) {
+        pending_cv.wait(lock, [this] { return done || !pending.empty(); });
+
+        if (pending.empty()) {
+            // done, and everything has been written
+            return;
+        }
+
+        std::vector<int16_t> next = std::move(pending.front());
+        pending.pop_front();
+
+        // write without holding the lock so the emulation thread never waits on the disk.
+        // Samples go out in host byte order, which is WAV's little-endian on everything we build for
+        lock.unlock();
+        file.write((const char *) next.data(), next.size() * sizeof(int16_t));
+        data_size += next.size() * sizeof(int16_t);
+        lock.lock();
+    }
+}
+
+void AudioCaptureDriver::writeHeader(uint32_t data_size) {
+    auto write32 = [this](uint32_t value) {
+        uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+        file.write((const char *) bytes, 4);
+    };
+    auto write16 = [this](uint16_t value) {
+        uint8_t bytes[2] = {(uint8_t) value, (uint8_t) (value >> 8)};
+        file.write((const char *) bytes, 2);
+    };
+
+    const uint16_t channels = 2;
+    const uint16_t bits = 16;
+
+    file.write("RIFF", 4);
+    write32(36 + data_size);
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    write32(16);
+    write16(1); // PCM
+    write16(channels);
+    write32(sampling_rate);
+    write32(sampling_rate * channels * bits / 8);
+    write16(channels * bits / 8);
+    write16(bits);
+
+    file.write("data", 4);
+    write32(data_size);
+}
\ No newline at end of file
@@ -10,4 +10,11 @@ uint16_t highestOrderBit(uint16_t num) {
     }
 
     return ret;
+}
+
+uint8_t reverseBits(uint8_t byte) {
+    byte = ((byte & 0xF0) >> 4) | ((byte & 0x0F) << 4);
+    byte = ((byte & 0xCC) >> 2) | ((byte & 0x33) << 2);
+    byte = ((byte & 0xAA) >> 1) | ((byte & 0x55) << 1);
+    return byte;
 }
\ No newline at end of file
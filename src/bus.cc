@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "bus.h"
 
 Bus::Bus(GameboyDriver *driver) : ppu(driver), apu(driver), controls(driver) {
@@ -6,12 +8,18 @@ Bus::Bus(GameboyDriver *driver) : ppu(driver), apu(driver), controls(driver) {
     cpu.connectBus(this);
     ppu.connectBus(this);
     timer.connectBus(this);
+    serial.connectBus(this);
     controls.connectBus(this);
 
     reset();
 }
 
 void Bus::cpuWrite(uint16_t addr, uint8_t data) {
+    // The external bus, VRAM and OAM are taken over by an active OAM DMA
+    if (dma_cycles && addr < 0xFF00) {
+        return;
+    }
+
     if (addr >= 0x0000 && addr < 0x8000) {
         cart->write(addr, data);
     } else if (addr >= 0x8000 && addr < 0xA000) {
@@ -30,6 +38,11 @@ void Bus::cpuWrite(uint16_t addr, uint8_t data) {
 }
 
 uint8_t Bus::cpuRead(uint16_t addr) {
+    // The external bus, VRAM and OAM are taken over by an active OAM DMA
+    if (dma_cycles && addr < 0xFF00) {
+        return 0xFF;
+    }
+
     if (addr >= 0x0000 && addr < 0x8000) {
         return cart->read(addr);
     } else if (addr >= 0x8000 && addr < 0xA000) {
@@ -57,34 +70,120 @@ void Bus::reset() {
     for (auto &i : ram) i = 0x00;
     for (auto &i : high_ram) i = 0x00;
 
+    dma = 0x00;
+    dma_cycles = 0;
+    poll_cycles = POLL_INTERVAL + 1;
+
     cpu.reset();
     ppu.reset();
     apu.reset();
+    serial.reset();
 }
 
 void Bus::run() {
-    uint32_t cycles;
-
     while(!driver->quitReceived()) {
-        // Poll controls for a quit
-        controls.updateControls();
+        // Poll controls for a quit at the start of each interval
+        runFor(POLL_INTERVAL + 1);
 
-        cycles = 0;
-        while (cycles <= POLL_INTERVAL) {
-            uint8_t elapsed = cpu.clock();
-            apu.clock(elapsed);
-            ppu.clock(elapsed);
-            timer.clock(elapsed);
+#ifdef GB_DEBUGGER
+        if (debugger.isStopped()) {
+            return;
+        }
+#endif
+    }
+}
+
+uint32_t Bus::runFor(uint32_t cycles) {
+    uint32_t ran = 0;
+
+    while (ran < cycles) {
+        if (poll_cycles > POLL_INTERVAL) {
+            controls.updateControls();
+            poll_cycles = 0;
+        }
 
-            cycles += elapsed;
+#ifdef GB_DEBUGGER
+        // a watchpoint stops after the instruction that hit it
+        if (debugger.isStopped()) {
+            break;
         }
+#endif
+
+        uint8_t elapsed = step();
+
+#ifdef GB_DEBUGGER
+        // the CPU held back an instruction for a breakpoint or step
+        if (!elapsed) {
+            break;
+        }
+#endif
+        ran += elapsed;
+        poll_cycles += elapsed;
+    }
+
+    return ran;
+}
+
+bool Bus::quitReceived() {
+    return driver->quitReceived();
+}
+
+Serial &Bus::getSerial() {
+    return serial;
+}
+
+#ifdef GB_DEBUGGER
+Debugger &Bus::getDebugger() {
+    return debugger;
+}
+
+CPU::REGISTERS Bus::getCPURegisters() {
+    return cpu.getRegisters();
+}
+#endif
+
+uint8_t Bus::step() {
+    uint8_t elapsed = cpu.clock();
+
+#ifdef GB_DEBUGGER
+    if (!elapsed) {
+        return 0;
     }
+#endif
+
+    clockDMA(elapsed);
+    apu.clock(elapsed);
+    ppu.clock(elapsed);
+    timer.clock(elapsed);
+    serial.clock(elapsed);
+
+    return elapsed;
 }
 
 void Bus::insertCartridge(const std::shared_ptr<Cartridge> cart) {
     this->cart = cart;
 }
 
+void Bus::setRenderInterval(uint32_t interval) {
+    ppu.setRenderInterval(interval);
+}
+
+void Bus::setAudioEnabled(bool enabled) {
+    apu.setAudioEnabled(enabled);
+}
+
+void Bus::setSerialCapture(bool enabled) {
+    serial.setCaptureEnabled(enabled);
+}
+
+const std::vector<uint8_t> &Bus::getSerialOutput() {
+    return serial.getCapturedOutput();
+}
+
+void Bus::flushAudio() {
+    apu.flush();
+}
+
 void Bus::saveState(const std::string &filename) {
     std::ofstream ofs(filename);
     cart->saveRAM(ofs);
@@ -99,8 +198,31 @@ void Bus::loadState(const std::string &filename) {
 
 void Bus::handleDMA(uint8_t data) {
     uint16_t dma_addr = data << 8;
-    for (uint8_t i = 0; i < OAM_SIZE; i++) {
-        cpuWrite(OAM_START + i, cpuRead(dma_addr + i));
+    dma = data;
+
+    // Writing DMA restarts any transfer already in progress
+    dma_cycles = 0;
+
+    if (dma_addr >= 0xC000) {
+        // Work RAM (sources past 0xE000 are echoes of it) is copied straight into OAM
+        ppu.dmaTransfer(&ram[dma_addr & 0x1FFF]);
+    } else {
+        // Cartridge and VRAM sources have to go through their own read logic
+        std::array<uint8_t, OAM_SIZE> block;
+        for (uint8_t i = 0; i < OAM_SIZE; i++) {
+            block[i] = cpuRead(dma_addr + i);
+        }
+
+        ppu.dmaTransfer(block.data());
+    }
+
+    // The copy itself is instant, but the bus stays locked for as long as the hardware transfer takes
+    dma_cycles = DMA_CYCLES;
+}
+
+void Bus::clockDMA(uint8_t clocks) {
+    if (dma_cycles) {
+        dma_cycles -= std::min((uint16_t) clocks, dma_cycles);
     }
 }
 
@@ -117,11 +239,12 @@ void Bus::handleIOWrite(uint16_t addr, uint8_t data) {
     if (apu.regWrite(addr, data)) {
         return;
     }
+    if (serial.regWrite(addr, data)) {
+        return;
+    }
 
     switch(addr) {
         case DMA: handleDMA(data); break;
-        case SB: sb = data; break;
-        case SC: sc = data; break;
         case IF: intr_flag = data; break;
     }
 }
@@ -140,10 +263,12 @@ uint8_t Bus::handleIORead(uint16_t addr) {
     if (controls.regRead(addr, val)) {
         return val;
     }
+    if (serial.regRead(addr, val)) {
+        return val;
+    }
 
     switch(addr) {
-        case SB: return sb; break;
-        case SC: return sc; break;
+        case DMA: return dma; break;
         case IF: return intr_flag; break;
     }
 
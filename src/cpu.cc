@@ -570,10 +570,19 @@ CPU::CPU() {
 
 // read & write to/from bus
 uint8_t CPU::read(uint16_t addr) {
+#ifdef GB_DEBUGGER
+    uint8_t data = bus->cpuRead(addr);
+    bus->getDebugger().checkRead(addr, data);
+    return data;
+#else
     return bus->cpuRead(addr);
+#endif
 }
 
 void CPU::write(uint16_t addr, uint8_t data) {
+#ifdef GB_DEBUGGER
+    bus->getDebugger().checkWrite(addr, data);
+#endif
     bus->cpuWrite(addr, data);
 }
 
@@ -581,6 +590,10 @@ void CPU::connectBus(Bus *bus) {
     this->bus = bus;
 }
 
+CPU::REGISTERS CPU::getRegisters() {
+    return {af, bc, de, hl, sp, pc};
+}
+
 void CPU::requestInterrupt(INTERRUPT intr) {
     if (intr == JOYPAD) {
         stopped = false;
@@ -621,6 +634,15 @@ uint8_t CPU::clock() {
         return 4;
     }
 
+#ifdef GB_DEBUGGER
+    // Only real instructions are checked, so halted cycles and interrupt dispatches never
+    // hit a breakpoint or count as a step. Nothing has changed yet, so a held instruction
+    // is simply tried again on the next clock
+    if (bus->getDebugger().shouldStop(pc)) {
+        return 0;
+    }
+#endif
+
     if (ei_called) {
         ime = true;
         ei_called = false;
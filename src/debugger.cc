@@ -0,0 +1,128 @@
+#include "debugger.h"
+
+Debugger::Debugger() {
+    clear();
+
+    stopped = false;
+    stepping = false;
+    resuming = false;
+    steps = 0;
+
+    stop_reason = STOP_NONE;
+    stop_address = 0;
+    stop_value = 0;
+}
+
+void Debugger::addBreakpoint(uint16_t addr) {
+    if (!breakpoints[addr]) {
+        breakpoints[addr] = true;
+        breakpoint_pages[addr >> DEBUG_PAGE_SHIFT]++;
+    }
+}
+
+void Debugger::removeBreakpoint(uint16_t addr) {
+    if (breakpoints[addr]) {
+        breakpoints[addr] = false;
+        breakpoint_pages[addr >> DEBUG_PAGE_SHIFT]--;
+    }
+}
+
+void Debugger::addWatchpoint(uint16_t addr, WATCH_TYPE type) {
+    removeWatchpoint(addr);
+
+    if (type & WATCH_READ) {
+        reads[addr] = true;
+        read_pages[addr >> DEBUG_PAGE_SHIFT]++;
+    }
+    if (type & WATCH_WRITE) {
+        writes[addr] = true;
+        write_pages[addr >> DEBUG_PAGE_SHIFT]++;
+    }
+}
+
+void Debugger::removeWatchpoint(uint16_t addr) {
+    if (reads[addr]) {
+        reads[addr] = false;
+        read_pages[addr >> DEBUG_PAGE_SHIFT]--;
+    }
+    if (writes[addr]) {
+        writes[addr] = false;
+        write_pages[addr >> DEBUG_PAGE_SHIFT]--;
+    }
+}
+
+void Debugger::clear() {
+    breakpoint_pages.fill(0);
+    read_pages.fill(0);
+    write_pages.fill(0);
+
+    breakpoints.reset();
+    reads.reset();
+    writes.reset();
+}
+
+void Debugger::resume() {
+    stopped = false;
+    stepping = false;
+    resuming = true;
+    stop_reason = STOP_NONE;
+}
+
+void Debugger::step(uint32_t count) {
+    resume();
+
+    stepping = true;
+    steps = count;
+}
+
+bool Debugger::isStopped() {
+    return stopped;
+}
+
+STOP_REASON Debugger::getStopReason() {
+    return stop_reason;
+}
+
+uint16_t Debugger::getStopAddress() {
+    return stop_address;
+}
+
+uint8_t Debugger::getStopValue() {
+    return stop_value;
+}
+
+bool Debugger::checkStop(uint16_t pc) {
+    if (!stopped) {
+        if (stepping && !steps) {
+            stop(STOP_STEP, pc, 0);
+        } else if (!resuming && breakpoints[pc]) {
+            stop(STOP_BREAKPOINT, pc, 0);
+        }
+    }
+
+    if (stopped) {
+        return true;
+    }
+
+    // this instruction runs, so any breakpoint we resumed from is behind us
+    resuming = false;
+    if (stepping) {
+        steps--;
+    }
+
+    return false;
+}
+
+void Debugger::stop(STOP_REASON reason, uint16_t addr, uint8_t data) {
+    // the first reason to stop wins
+    if (stopped) {
+        return;
+    }
+
+    stopped = true;
+    stepping = false;
+
+    stop_reason = reason;
+    stop_address = addr;
+    stop_value = data;
+}
\ No newline at end of file
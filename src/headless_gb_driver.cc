@@ -0,0 +1,62 @@
+#include <algorithm>
+
+#include "headless_gb_driver.h"
+
+HeadlessGameboyDriver::HeadlessGameboyDriver(uint32_t frame_limit) : GameboyDriver(HEADLESS_SAMPLE_RATE) {
+    this->frame_limit = frame_limit;
+    frame_count = 0;
+    frame.fill(0);
+
+    quit = false;
+}
+
+void HeadlessGameboyDriver::drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) {
+    (void) argb;
+
+    if (y < SCREEN_HEIGHT) {
+        std::copy(colors, colors + SCREEN_WIDTH, &frame[y * SCREEN_WIDTH]);
+    }
+}
+
+void HeadlessGameboyDriver::render(bool frame_changed) {
+    (void) frame_changed;
+
+    frame_count++;
+
+    if (frame_limit && frame_count >= frame_limit) {
+        quit = true;
+    }
+}
+
+void HeadlessGameboyDriver::pushSamples(const float *samples, uint32_t count) {
+    (void) samples;
+    (void) count;
+}
+
+bool HeadlessGameboyDriver::quitReceived() {
+    return quit;
+}
+
+ControllerState HeadlessGameboyDriver::pollControls() {
+    ControllerState controls;
+    controls.data = 0;
+
+    return controls;
+}
+
+uint32_t HeadlessGameboyDriver::getFrameCount() {
+    return frame_count;
+}
+
+const uint8_t *HeadlessGameboyDriver::getFrame() {
+    return frame.data();
+}
+
+uint64_t HeadlessGameboyDriver::getFrameHash() {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint8_t color : frame) {
+        hash = (hash ^ color) * 0x100000001B3;
+    }
+
+    return hash;
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "link_cable.h"
+
+// Spins this many times waiting at the barrier before yielding the core
+#define BARRIER_SPINS 1024
+
+
+// Meeting point for the two machine threads. The last to arrive runs the completion
+// before releasing the other, so it sees both machines stopped
+class LinkBarrier {
+    public:
+        template <typename Completion>
+        void wait(Completion completion) {
+            uint32_t generation = this->generation.load(std::memory_order_acquire);
+
+            if (arrived.fetch_add(1, std::memory_order_acq_rel) == 1) {
+                completion();
+
+                arrived.store(0, std::memory_order_relaxed);
+                this->generation.fetch_add(1, std::memory_order_release);
+                return;
+            }
+
+            uint32_t spins = 0;
+            while (this->generation.load(std::memory_order_acquire) == generation) {
+                if (++spins > BARRIER_SPINS) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        std::atomic<uint32_t> arrived = 0;
+        std::atomic<uint32_t> generation = 0;
+};
+
+LinkCable::LinkCable(Bus *first, Bus *second) {
+    buses = {first, second};
+    times = {0, 0};
+    target = 0;
+    transfers = 0;
+
+    for (Bus *bus : buses) {
+        bus->getSerial().setLinked(true);
+    }
+
+    scheduleChunk();
+}
+
+LinkCable::~LinkCable() {
+    for (Bus *bus : buses) {
+        bus->getSerial().setLinked(false);
+    }
+}
+
+void LinkCable::run(bool threaded) {
+    auto quitReceived = [this]() {
+        return buses[0]->quitReceived() || buses[1]->quitReceived();
+    };
+
+    if (!threaded) {
+        while (!quitReceived()) {
+            runToTarget(0);
+            runToTarget(1);
+
+            exchange();
+            scheduleChunk();
+        }
+        return;
+    }
+
+    LinkBarrier barrier;
+    bool done = quitReceived();
+
+    auto runMachine = [&](uint32_t index) {
+        while (!done) {
+            runToTarget(index);
+
+            barrier.wait([&]() {
+                exchange();
+                scheduleChunk();
+                done = quitReceived();
+            });
+        }
+    };
+
+    std::thread second(runMachine, 1);
+    runMachine(0);
+    second.join();
+}
+
+uint64_t LinkCable::getTransferCount() {
+    return transfers;
+}
+
+void LinkCable::runToTarget(uint32_t index) {
+    if (times[index] < target) {
+        times[index] += buses[index]->runFor(target - times[index]);
+    }
+}
+
+void LinkCable::exchange() {
+    for (uint32_t i = 0; i < 2; i++) {
+        Serial &serial = buses[i]->getSerial();
+        Serial &other = buses[1 - i]->getSerial();
+
+        if (serial.isTransferDue()) {
+            // a side waiting on its own clock isn't listening, and reads back 0xFF
+            serial.completeTransfer(other.receiveExternal(serial.getOutgoing()));
+            transfers++;
+        }
+    }
+}
+
+void LinkCable::scheduleChunk() {
+    target += LINK_QUANTUM;
+
+    // stop both machines where the next transfer finishes
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t remaining = buses[i]->getSerial().getCyclesUntilTransfer();
+        if (remaining != SERIAL_NO_TRANSFER) {
+            target = std::min(target, times[i] + remaining);
+        }
+    }
+}
\ No newline at end of file
@@ -1,38 +1,53 @@
 #include "bus.h"
 #include "sdl_gb_driver.h"
+#include "socket_link.h"
 
 
-SDLGameboyDriver::SDLGameboyDriver(std::string title) : GameboyDriver(SAMPLE_RATE) {
+SDLGameboyDriver::SDLGameboyDriver(std::string title, uint32_t window_scale, SCALE_MODE scale_mode,
+                                   uint32_t latency_target) : GameboyDriver(SAMPLE_RATE) {
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
     window = SDL_CreateWindow(title.c_str(), 
                      SDL_WINDOWPOS_UNDEFINED,
                      SDL_WINDOWPOS_UNDEFINED,
-                     SCREEN_WIDTH * SCALE_FACTOR,
-                     SCREEN_HEIGHT * SCALE_FACTOR,
-                     SDL_WINDOW_OPENGL);
+                     SCREEN_WIDTH * window_scale,
+                     SCREEN_HEIGHT * window_scale,
+                     SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
-    texture = SDL_CreateTexture(renderer,
-                                SDL_PIXELFORMAT_ARGB8888,
-                                SDL_TEXTUREACCESS_STREAMING,
-                                SCREEN_WIDTH * SCALE_FACTOR,
-                                SCREEN_HEIGHT * SCALE_FACTOR);
+    // keep the aspect ratio when the window is resized, letterboxing if needed
+    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    texture = nullptr;
+    setScaleMode(scale_mode);
 
     int32_t num_keys;
     keyboard_state = SDL_GetKeyboardState(&num_keys);
 
-    // Lock texture so we're ready to start drawing pixels to it
-    int32_t pitch;
-    SDL_LockTexture(texture, nullptr, (void **) &pixels, &pitch);
+    redraw = false;
+    controls = 0;
+    quit_requested = false;
+    turbo = false;
+    speed = 1.0;
 
-    SDL_AudioSpec audio_settings;
+    SDL_AudioSpec audio_settings = {};
     audio_settings.freq = sampling_rate;
     audio_settings.format = AUDIO_F32SYS;
     audio_settings.channels = 2;
-    audio_settings.callback = nullptr;
-    samples_stored = 0;
+    audio_settings.samples = AUDIO_DEVICE_SAMPLES;
+    audio_settings.callback = audioCallback;
+    audio_settings.userdata = this;
+
+    setLatencyTarget(latency_target);
+    underruns = 0;
+    rate_adjustment = 1.0;
+    rate_integral = 0.0;
+    primed = false;
+    ran_unlimited = false;
+
+    previous_sample.fill(0.0F);
+    resample_position = 0.0;
 
     const char *audio_device_name = SDL_GetAudioDeviceName(1, 0);
     audio_device_id = SDL_OpenAudioDevice(audio_device_name, false, &audio_settings, nullptr, false);
@@ -40,155 +55,299 @@ SDLGameboyDriver::SDLGameboyDriver(std::string title) : GameboyDriver(SAMPLE_RAT
     std::cout << audio_device_name << std::endl;
 
     time = std::chrono::steady_clock::now();
+    frame_time = std::chrono::duration<double>(FRAME_DURATION).count();
+    render_interval = 1;
     quit = false;
 }
 
 SDLGameboyDriver::~SDLGameboyDriver() {
+    // stop the callback before the ring buffer goes away
+    SDL_CloseAudioDevice(audio_device_id);
+
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
-uint32_t SDLGameboyDriver::getARGBColor(COLOR color) {
-    uint8_t r, g, b;
-    switch (color) {
-        case WHITE:
-            r = 155;
-            g = 188;
-            b = 15;
-            break;
-        case LIGHT_GREEN:
-            r = 139;
-            g = 172;
-            b = 15;
-            break;
-        case DARK_GREEN:
-            r = 48;
-            g = 98;
-            b = 48;
-            break;
-        case BLACK:
-            r = 15;
-            g = 56;
-            b = 15;
-            break;
-        case UNLIT:
-            r = g = b = 255;
-            break;
+void SDLGameboyDriver::drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) {
+    (void) colors;
+
+    if (y < SCREEN_HEIGHT) {
+        std::copy(argb, argb + SCREEN_WIDTH, &frames.getWriteBuffer()[y * SCREEN_WIDTH]);
+    }
+}
+
+void SDLGameboyDriver::render(bool frame_changed) {
+    // unchanged and skipped frames aren't handed over, so the display thread has nothing to upload or present
+    if (frame_changed) {
+        frames.publish();
     }
 
-    return (r << 16) | (g << 8) | (b << 0);
+    double multiplier = getEffectiveSpeed();
+    if (multiplier == SPEED_UNLIMITED) {
+        // run flat out, and pick the schedule back up from here once speed is limited again
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - time;
+        time = now;
+
+        // draw about as many frames as the display shows, going by how fast frames are emulated
+        frame_time += (elapsed.count() - frame_time) * FRAME_TIME_SMOOTHING;
+        double frames_per_display = std::chrono::duration<double>(FRAME_DURATION).count() / frame_time;
+        render_interval = (uint32_t) std::clamp(frames_per_display, 1.0, (double) MAX_RENDER_INTERVAL);
+    } else {
+        // above normal speed, the display drops all but about one in every multiplier frames
+        render_interval = (uint32_t) std::max(multiplier, 1.0);
+
+        // frames are due at fixed intervals, so time spent emulating doesn't add up
+        auto frame_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(FRAME_DURATION / multiplier);
+        time += frame_duration;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now < time) {
+            std::this_thread::sleep_until(time);
+        } else if (now - time > frame_duration) {
+            // too far behind to catch up, start over from here
+            time = now;
+        }
+    }
+
+    if (multiplier == SPEED_UNLIMITED) {
+        // no audio is pushed while running flat out, so the draining buffer says nothing about
+        // drift. Hold the controller as it is rather than winding the integral up
+        ran_unlimited = true;
+        return;
+    }
+
+    if (ran_unlimited) {
+        // audio is back with an empty buffer. Refill it to the target before playing, and let the
+        // integral find the drift again from scratch
+        ran_unlimited = false;
+        rate_integral = 0.0;
+        primed = false;
+    }
+
+    // audio stays in step with video by running slightly fast when the buffer is below the
+    // latency target and slightly slow when it's above. The integral soaks up steady drift
+    // between the emulated clock and the audio device's
+    double error = std::clamp(((double) latency_target - samples.size()) / latency_target, -1.0, 1.0);
+    rate_integral = std::clamp(rate_integral + error * RATE_INTEGRAL_GAIN, -MAX_RATE_ADJUSTMENT, MAX_RATE_ADJUSTMENT);
+    rate_adjustment = 1 + std::clamp(error * MAX_RATE_ADJUSTMENT + rate_integral, -MAX_RATE_ADJUSTMENT, MAX_RATE_ADJUSTMENT);
 }
 
-void SDLGameboyDriver::draw(COLOR color, uint8_t x, uint8_t y) {
-    if (x < SCREEN_WIDTH && y < SCREEN_HEIGHT) {
-        uint32_t argb_color = getARGBColor(color);
-        for (uint8_t y_disp = 0; y_disp < SCALE_FACTOR; y_disp++) {
-            for (uint8_t x_disp = 0; x_disp < SCALE_FACTOR; x_disp++) {
-                uint32_t i = ((x * SCALE_FACTOR) + x_disp) + ((y * SCALE_FACTOR) + y_disp) * (SCREEN_WIDTH * SCALE_FACTOR);
-                pixels[i] = argb_color;
+void SDLGameboyDriver::pushSamples(const float *samples, uint32_t count) {
+    if (!count) {
+        return;
+    }
+
+    double multiplier = getEffectiveSpeed();
+
+    if (multiplier == SPEED_UNLIMITED) {
+        // there's no keeping up with the emulator, so there's no audio
+        return;
+    }
+
+    if (multiplier != 1.0) {
+        // step through the block multiplier samples at a time, interpolating between neighbours.
+        // Sample -1 is the last one of the previous block
+        resampled.clear();
+
+        for (; resample_position < count; resample_position += multiplier) {
+            uint32_t i = resample_position;
+            float fraction = resample_position - i;
+
+            for (uint8_t side = 0; side < 2; side++) {
+                float from = i ? samples[(i - 1) * 2 + side] : previous_sample[side];
+                float to = samples[i * 2 + side];
+                resampled.push_back(from + (to - from) * fraction);
             }
         }
+
+        resample_position -= count;
+        previous_sample = {samples[(count - 1) * 2], samples[(count - 1) * 2 + 1]};
+
+        samples = resampled.data();
+        count = resampled.size() / 2;
     }
+
+    // drop samples if the device has fallen too far behind
+    this->samples.push(samples, count * 2);
 }
 
-void SDLGameboyDriver::render() {
-    SDL_UnlockTexture(texture);
+void SDLGameboyDriver::setSpeed(double multiplier) {
+    speed = (multiplier == SPEED_UNLIMITED) ? SPEED_UNLIMITED : std::clamp(multiplier, MIN_SPEED, MAX_SPEED);
+}
 
-    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-    SDL_RenderPresent(renderer);
-    SDL_RenderClear(renderer);
+double SDLGameboyDriver::getSpeed() const {
+    return speed;
+}
 
-    int pitch;
-    SDL_LockTexture(texture, nullptr, (void **) &pixels, &pitch);
-    
-    // don't sleep if we don't have enough audio samples
-    if (SDL_GetQueuedAudioSize(audio_device_id) > sampling_rate) {
-        std::this_thread::sleep_until(time + std::chrono::nanoseconds(16742706));
+double SDLGameboyDriver::getEffectiveSpeed() const {
+    return turbo ? SPEED_UNLIMITED : (double) speed;
+}
+
+double SDLGameboyDriver::getRateAdjustment() {
+    return rate_adjustment;
+}
+
+uint32_t SDLGameboyDriver::getRenderInterval() {
+    return render_interval;
+}
+
+void SDLGameboyDriver::setLatencyTarget(uint32_t ms) {
+    size_t target = (size_t) ms * sampling_rate / 1000 * 2;
+    latency_target = std::clamp(target, (size_t) AUDIO_DEVICE_SAMPLES * 2, (size_t) AUDIO_BUFFER_SIZE / 2);
+}
+
+double SDLGameboyDriver::getAudioLatency() const {
+    return samples.size() / 2 * 1000.0 / sampling_rate;
+}
+
+uint32_t SDLGameboyDriver::getUnderrunCount() const {
+    return underruns;
+}
+
+void SDLGameboyDriver::audioCallback(void *userdata, uint8_t *stream, int len) {
+    SDLGameboyDriver *driver = (SDLGameboyDriver *) userdata;
+    float *out = (float *) stream;
+    size_t requested = len / sizeof(float);
+
+    // after an underrun, play silence until the buffer is back up to the target
+    if (!driver->primed) {
+        if (driver->samples.size() < driver->latency_target) {
+            std::fill(out, out + requested, 0.0F);
+            return;
+        }
+
+        driver->primed = true;
+    }
+
+    size_t read = driver->samples.pop(out, requested);
+    if (read < requested) {
+        std::fill(out + read, out + requested, 0.0F);
+
+        driver->underruns++;
+        driver->primed = false;
     }
-    
-    time = std::chrono::steady_clock::now();
 }
 
-void SDLGameboyDriver::pushSample(AudioOutput output) {
-    // samples are only provided at the rate that we request in sampling_rate, so we don't need to downsample
-    float unprocessed_sample;
-    float left_sample = 0;
-    float right_sample = 0;
-
-    // mix channel 1
-    unprocessed_sample = output.ch1_left / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &left_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-    unprocessed_sample = output.ch1_right / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &right_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-
-    // mix channel 2
-    unprocessed_sample = output.ch2_left / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &left_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-    unprocessed_sample = output.ch2_right / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &right_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-
-    // mix channel 3
-    unprocessed_sample = output.ch3_left / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &left_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-    unprocessed_sample = output.ch3_right / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &right_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-
-    // mix channel 4
-    unprocessed_sample = output.ch4_left / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &left_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-    unprocessed_sample = output.ch4_right / 100.0F;
-    SDL_MixAudioFormat((uint8_t *) &right_sample, (uint8_t *) &unprocessed_sample, AUDIO_F32SYS, sizeof(float), SDL_MIX_MAXVOLUME / 100);
-
-    // push left and right samples
-    samples[samples_stored] = left_sample;
-    samples[samples_stored + 1] = right_sample;
-    samples_stored += 2;
-
-    if (samples_stored >= SAMPLE_SIZE) {
-        SDL_QueueAudio(audio_device_id, samples.data(), SAMPLE_SIZE * sizeof(float));
-        samples_stored = 0;
+void SDLGameboyDriver::runDisplay() {
+    while (!quit_requested) {
+        handleEvents();
+
+        if (frames.acquire() || redraw) {
+            presentFrame(frames.getReadBuffer());
+            redraw = false;
+        } else {
+            // nothing new to show yet
+            SDL_Delay(DISPLAY_IDLE_DELAY);
+        }
     }
 }
 
-bool SDLGameboyDriver::quitReceived() {
-    return quit;
+void SDLGameboyDriver::presentFrame(const Frame &frame) {
+    SDL_UpdateTexture(texture, nullptr, frame.data(), SCREEN_WIDTH * sizeof(uint32_t));
+
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
 }
 
-ControllerState SDLGameboyDriver::pollControls() {
-    ControllerState controls;
+void SDLGameboyDriver::setWindowScale(uint32_t scale) {
+    SDL_SetWindowSize(window, SCREEN_WIDTH * scale, SCREEN_HEIGHT * scale);
+}
 
+void SDLGameboyDriver::setScaleMode(SCALE_MODE mode) {
+    // the filter is picked up when a texture is created
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, (mode == SCALE_LINEAR) ? "linear" : "nearest");
+
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+
+    texture = SDL_CreateTexture(renderer,
+                                SDL_PIXELFORMAT_ARGB8888,
+                                SDL_TEXTUREACCESS_STREAMING,
+                                SCREEN_WIDTH,
+                                SCREEN_HEIGHT);
+}
+
+void SDLGameboyDriver::handleEvents() {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
-            quit = true;
+            quit_requested = true;
+        }
+
+        if (event.type == SDL_WINDOWEVENT) {
+            redraw = true;
+        }
+
+        if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+            double current = speed;
+
+            switch (event.key.keysym.scancode) {
+                case SPEED_DOWN_KEY:
+                    setSpeed((current == SPEED_UNLIMITED) ? MAX_SPEED : current / 2);
+                    break;
+                case SPEED_UP_KEY:
+                    setSpeed((current == SPEED_UNLIMITED || current * 2 > MAX_SPEED) ? SPEED_UNLIMITED : current * 2);
+                    break;
+                case SPEED_RESET_KEY:
+                    setSpeed(1.0);
+                    break;
+                default:
+                    break;
+            }
         }
     }
 
-    controls.a      = keyboard_state[SDL_SCANCODE_X];
-    controls.b      = keyboard_state[SDL_SCANCODE_Z];
-    controls.select = keyboard_state[SDL_SCANCODE_BACKSPACE];
-    controls.start  = keyboard_state[SDL_SCANCODE_RETURN];
-    controls.right  = keyboard_state[SDL_SCANCODE_RIGHT];
-    controls.left   = keyboard_state[SDL_SCANCODE_LEFT];
-    controls.up     = keyboard_state[SDL_SCANCODE_UP];
-    controls.down   = keyboard_state[SDL_SCANCODE_DOWN];
+    turbo = keyboard_state[TURBO_KEY];
+
+    ControllerState state;
+    state.data = 0;
+
+    state.a      = keyboard_state[SDL_SCANCODE_X];
+    state.b      = keyboard_state[SDL_SCANCODE_Z];
+    state.select = keyboard_state[SDL_SCANCODE_BACKSPACE];
+    state.start  = keyboard_state[SDL_SCANCODE_RETURN];
+    state.right  = keyboard_state[SDL_SCANCODE_RIGHT];
+    state.left   = keyboard_state[SDL_SCANCODE_LEFT];
+    state.up     = keyboard_state[SDL_SCANCODE_UP];
+    state.down   = keyboard_state[SDL_SCANCODE_DOWN];
+
+    controls = state.data;
+}
 
-    return controls;
+bool SDLGameboyDriver::quitReceived() {
+    return quit_requested;
 }
 
+ControllerState SDLGameboyDriver::pollControls() {
+    ControllerState state;
+    state.data = controls;
+
+    return state;
+}
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " rom_file" << std::endl;
+    if (argc < 2 || argc > 7 || argc == 6) {
+        std::cout << "Usage: " << argv[0] << " rom_file [scale] [nearest|linear] [speed] [listen|connect address]" << std::endl;
+        std::cout << "A speed of 0 runs unlimited. Hold tab for turbo, - and = halve and double the speed, 0 resets it" << std::endl;
+        std::cout << "The link cable connects to another process over a unix:path or host:port address" << std::endl;
         return EXIT_FAILURE;
     }
 
+    uint32_t window_scale = (argc >= 3) ? std::stoul(argv[2]) : DEFAULT_WINDOW_SCALE;
+    SCALE_MODE scale_mode = (argc >= 4 && std::string(argv[3]) == "linear") ? SCALE_LINEAR : SCALE_NEAREST;
+    double speed = (argc >= 5) ? std::stod(argv[4]) : 1.0;
+
     std::string gb_filename = std::string(argv[1]);
     std::string save_filename = gb_filename.substr(0, gb_filename.find_last_of(".")) + ".sav";
 
     std::shared_ptr<Cartridge> cart = std::make_shared<Cartridge>(gb_filename);
-    SDLGameboyDriver driver = SDLGameboyDriver(cart->getTitle());
+    SDLGameboyDriver driver = SDLGameboyDriver(cart->getTitle(), window_scale, scale_mode);
+
+    driver.setSpeed(speed);
 
     Bus bus(&driver);
     bus.insertCartridge(cart);
@@ -196,10 +355,28 @@ int main(int argc, char **argv) {
     // load save file if it exists
     bus.loadState(save_filename);
 
-    bus.run();
+    std::unique_ptr<SocketLink> link;
+    if (argc == 7) {
+        LINK_ROLE role = (std::string(argv[5]) == "listen") ? LINK_LISTEN : LINK_CONNECT;
+        link = std::make_unique<SocketLink>(&bus, role, std::string(argv[6]));
+    }
+
+    // the emulator gets its own thread so presenting frames never holds it up
+    std::thread emulation([&bus, &link]() {
+        if (link) {
+            link->run();
+        } else {
+            bus.run();
+        }
+    });
+    driver.runDisplay();
+    emulation.join();
 
     // save state before exiting
     bus.saveState(save_filename);
+
+    std::cout << "Audio latency " << driver.getAudioLatency() << " ms, "
+              << driver.getUnderrunCount() << " underruns" << std::endl;
     
     return EXIT_SUCCESS;
 }
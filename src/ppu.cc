@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "bit_utils.h"
 #include "bus.h"
 #include "interrupt.h"
 #include "ppu.h"
@@ -5,6 +9,7 @@
 PPU::PPU(GameboyDriver *driver) {
     this->driver = driver;
     pixel_line.reserve(SCREEN_WIDTH);
+    render_interval = 1;
 
     reset();
 }
@@ -16,6 +21,14 @@ void PPU::reset() {
 
     transfer_cycles = 0;
     pixel_line.clear();
+    sprite_count = 0;
+
+    skipped_frames = 0;
+    draw_frame = render_interval != 0;
+
+    // nothing matches a color that doesn't exist, so the first frame always counts as changed
+    for (auto &line : previous_lines) line.fill(0xFF);
+    frame_changed = false;
 
     setStatus(OAM_SEARCH);
 
@@ -30,6 +43,10 @@ void PPU::reset() {
     wy = 0x00;
     wx = 0x00;
 
+    updatePalette(BG_PALETTE, bgp);
+    updatePalette(OBP0_PALETTE, obp0);
+    updatePalette(OBP1_PALETTE, obp1);
+    updatePalette(UNLIT_PALETTE, 0x00);
 }
 
 void PPU::clock(uint8_t clocks) {
@@ -101,7 +118,19 @@ void PPU::clockedVBlank() {
         checkSTATLYC();
     } else if (!ly && cycles >= 400) {
         // transition to OAM search
-        this->driver->render();
+        this->driver->render(frame_changed);
+        frame_changed = false;
+
+        // Decide whether the coming frame gets drawn. The driver can skip more on top, while
+        // it's running faster than it can show frames
+        uint32_t interval = render_interval * driver->getRenderInterval();
+        skipped_frames++;
+
+        draw_frame = interval && skipped_frames >= interval;
+        if (draw_frame) {
+            skipped_frames = 0;
+        }
+
         searchOAM(ly + 1);
         setStatus(OAM_SEARCH);
         cycles -= 400;
@@ -112,7 +141,13 @@ void PPU::clockedVBlank() {
 void PPU::clockedOAMSearch() {
     if (cycles >= 80) {
         // transition to Pixel Transfer
-        fetchLine();
+        // Transfer length has to be known even on frames that aren't drawn
+        transfer_cycles = 172;
+
+        if (draw_frame) {
+            fetchLine();
+        }
+
         setStatus(PIXEL_TRANSFER);
         cycles -= 80;
     }
@@ -120,7 +155,10 @@ void PPU::clockedOAMSearch() {
 void PPU::clockedPixelTransfer() {
     if (cycles >= transfer_cycles) {
         // transition to H Blank
-        drawLine();
+        if (draw_frame) {
+            drawLine();
+        }
+
         setStatus(H_BLANK);
         checkSTATHBlank();
         cycles -= transfer_cycles;
@@ -191,12 +229,12 @@ void PPU::updateReg() {
 }
 
 void PPU::searchOAM(uint8_t line) {
-    sprites.clear();
+    sprite_count = 0;
 
     uint16_t addr = OAM_START;
     uint8_t obj_height = getOBJHeight();
 
-    while ((sprites.size() < 10) && (addr < OAM_END)) {
+    while ((sprite_count < MAX_LINE_SPRITES) && (addr < OAM_END)) {
         Sprite sprite;
         sprite.pos_y    = read(addr);
         sprite.pos_x    = read(addr + 1);
@@ -204,7 +242,13 @@ void PPU::searchOAM(uint8_t line) {
         sprite.flags    = read(addr + 3);
 
         if (((sprite.pos_y - 16) <= line) && ((sprite.pos_y - 16 + obj_height) > line)) {
-            sprites.push_back(sprite);
+            // Sprites with a smaller x position are drawn over those with a larger x.
+            // Ties go to whichever sprite comes first in OAM, so it goes after any equal x
+            uint8_t i = sprite_count++;
+            for (; i && sprite < sprites[i - 1]; i--) {
+                sprites[i] = sprites[i - 1];
+            }
+            sprites[i] = sprite;
         }
 
         addr += 4;
@@ -212,9 +256,142 @@ void PPU::searchOAM(uint8_t line) {
 }
 
 void PPU::fetchLine() {
+#ifdef SCALAR_COMPOSITOR
+    composeLineScalar();
+#else
+    composeLine();
+#endif
+
+#ifdef VERIFY_COMPOSITOR
+    std::array<uint8_t, SCREEN_WIDTH> composed = line;
+    composeLineScalar();
+
+    if (composed != line) {
+        throw std::runtime_error("Planar and scalar compositors disagree.");
+    }
+#endif
+}
+
+void PPU::composeLine() {
+    fetchBGPlanes();
+    fetchWinPlanes();
+    fetchOBJPlanes();
+
+    // Sprites show unless they're behind the BG and the BG color isn't 0
+    Plane show_obj = obj_mask & ~(obj_behind & (bg_lo | bg_hi));
+    Plane show_bg = ~show_obj;
+    Plane show_unlit = show_bg & unlit;
+
+    Plane color_lo = (show_obj & obj_lo) | (show_bg & bg_lo);
+    Plane color_hi = (show_obj & obj_hi) | (show_bg & bg_hi);
+
+    // BG_PALETTE is 0, so only sprite and unlit pixels set palette bits
+    Plane palette_lo = (show_obj & ~obj_pal) | show_unlit;
+    Plane palette_hi = (show_obj & obj_pal) | show_unlit;
+
+    planeUnpack(color_lo, color_hi, palette_lo, palette_hi, line.data(), SCREEN_WIDTH);
+}
+
+void PPU::fetchBGPlanes() {
+    // If BG is not enabled we give unlit pixels
+    if (!isBGEnabled()) {
+        bg_lo = bg_hi = {};
+        unlit = planeRange(0, SCREEN_WIDTH);
+        return;
+    }
+
+    unlit = {};
+
+    // X & Y coordinates of our starting tile in the BG tile map
+    uint8_t tile_x = (scx / 8) & 0x1F;
+    uint8_t tile_y = ((scy + ly) / 8) & 0x1F;
+
+    // Which line of the tiles we're fetching
+    uint8_t tile_line = (scy + ly) % 8;
+    uint16_t line_start = getBGTilemapStart() + tile_y * 0x20;
+
+    // 21 tiles cover the line at any fine scroll
+    std::array<uint8_t, PLANE_WORDS * 8> low_bytes = {};
+    std::array<uint8_t, PLANE_WORDS * 8> high_bytes = {};
+
+    for (uint8_t i = 0; i < 21; i++) {
+        uint8_t tile_id = read(line_start + ((tile_x + i) & 0x1F));
+        fetchTileBytes(tile_id, tile_line, low_bytes[i], high_bytes[i]);
+    }
+
+    bg_lo = planeFromBytes(low_bytes.data(), scx % 8);
+    bg_hi = planeFromBytes(high_bytes.data(), scx % 8);
+}
+
+void PPU::fetchWinPlanes() {
+    uint8_t win_x = std::max(0, wx - 7); // WX values of 0-7 act weirdly so we just set those to 0
+    uint8_t win_y = wy;
+
+    if (!isWinEnabled() || (ly < win_y) || (win_x >= SCREEN_WIDTH)) {
+        return;
+    }
+
+    uint8_t win_line = ly - win_y;
+    uint8_t tile_y = (win_line / 8) & 0x1F;
+    uint8_t tile_line = win_line % 8;
+    uint16_t line_start = getWinTilemapStart() + tile_y * 0x20;
+
+    std::array<uint8_t, PLANE_WORDS * 8> low_bytes = {};
+    std::array<uint8_t, PLANE_WORDS * 8> high_bytes = {};
+
+    for (uint8_t i = 0; i < (SCREEN_WIDTH - win_x + 7) / 8; i++) {
+        uint8_t tile_id = read(line_start + i);
+        fetchTileBytes(tile_id, tile_line, low_bytes[i], high_bytes[i]);
+    }
+
+    // The window replaces the BG from win_x onwards
+    Plane win_mask = planeRange(win_x, SCREEN_WIDTH);
+    Plane win_lo = planeShiftRight(planeFromBytes(low_bytes.data(), 0), win_x);
+    Plane win_hi = planeShiftRight(planeFromBytes(high_bytes.data(), 0), win_x);
+
+    bg_lo = (bg_lo & ~win_mask) | (win_lo & win_mask);
+    bg_hi = (bg_hi & ~win_mask) | (win_hi & win_mask);
+}
+
+void PPU::fetchOBJPlanes() {
+    obj_lo = obj_hi = obj_mask = obj_pal = obj_behind = {};
+
+    if (!isOBJEnabled()) {
+        return;
+    }
+
+    // sprites are already in priority order, highest first
+    for (uint8_t i = 0; i < sprite_count; i++) {
+        const Sprite &sprite = sprites[i];
+
+        uint8_t low_byte, high_byte;
+        fetchOBJBytes(sprite, ly, low_byte, high_byte);
+
+        Plane sprite_lo = {};
+        Plane sprite_hi = {};
+        planePlaceByte(sprite_lo, sprite.pos_x - 8, low_byte);
+        planePlaceByte(sprite_hi, sprite.pos_x - 8, high_byte);
+
+        // Only opaque pixels not already claimed by a higher priority sprite
+        Plane claimed = (sprite_lo | sprite_hi) & ~obj_mask;
+
+        obj_lo |= sprite_lo & claimed;
+        obj_hi |= sprite_hi & claimed;
+        obj_mask |= claimed;
+
+        if (sprite.flags & 0x10) {
+            obj_pal |= claimed;
+        }
+
+        if (sprite.flags & 0x80) {
+            obj_behind |= claimed;
+        }
+    }
+}
+
+void PPU::composeLineScalar() {
     pixel_line.clear();
 
-    transfer_cycles = 172;
     uint8_t win_x = std::max(0, wx - 7); // WX values of 0-7 act weirdly so we just set those to 0
     uint8_t win_y = wy;
 
@@ -227,6 +404,7 @@ void PPU::fetchLine() {
     }
 
     fetchOBJ(ly);
+    packLine();
 }
 
 void PPU::fetchBG(uint8_t line, uint8_t num_pixels) {
@@ -261,14 +439,7 @@ void PPU::fetchBG(uint8_t line, uint8_t num_pixels) {
         fetchTileLine(tile_id, tile_line, fetched);
 
         // Make sure we don't insert too many pixels
-        uint8_t num_insert = std::min((uint8_t) 8, num_pixels);
-
-        // Protect against underflow
-        if (skip_pixels > num_insert) {
-            num_insert = 0;
-        } else {
-            num_insert -= skip_pixels;
-        }
+        uint8_t num_insert = std::min((uint8_t) (8 - skip_pixels), num_pixels);
 
         // Insert pixels
         pixel_line.insert(pixel_line.end(),
@@ -311,26 +482,29 @@ void PPU::fetchOBJ(uint8_t line) {
         return;
     }
 
-    // Sprites with smaller x position will overwrite those with a larger x,
-    // so we add them to the line from right to left
-    std::sort(sprites.begin(), sprites.end(), std::greater());
+    // The highest priority opaque sprite pixel claims its spot, even if it ends up behind the BG
+    std::array<bool, SCREEN_WIDTH> claimed = {};
 
     std::array<Pixel, 8> fetched;
-    for (const auto &sprite : sprites) {
+    for (uint8_t s = 0; s < sprite_count; s++) {
+        const Sprite &sprite = sprites[s];
         fetchOBJLine(sprite, line, fetched);
 
         for (uint8_t i = 0; i < 8; i++) {
             uint8_t x = sprite.pos_x - 8 + i;
 
-            if ((x > 0 && x < SCREEN_WIDTH) && fetched[i].color != 0 && 
-                (pixel_line[x].color == 0 || (~sprite.flags & 0x80))) {
-                pixel_line[x] = fetched[i];
+            if (x < SCREEN_WIDTH && fetched[i].color != 0 && !claimed[x]) {
+                claimed[x] = true;
+
+                if (pixel_line[x].color == 0 || (~sprite.flags & 0x80)) {
+                    pixel_line[x] = fetched[i];
+                }
             }
         }
     }
 }
 
-void PPU::fetchTileLine(uint8_t tile_id, uint8_t tile_line, std::array<Pixel, 8> &out) {
+void PPU::fetchTileBytes(uint8_t tile_id, uint8_t tile_line, uint8_t &low_byte, uint8_t &high_byte) {
     uint16_t addr;
     if (lcdc & 0x10) {
         addr = 0x8000 + (tile_id * 0x10);
@@ -339,16 +513,11 @@ void PPU::fetchTileLine(uint8_t tile_id, uint8_t tile_line, std::array<Pixel, 8>
     }
 
     addr += tile_line * 2;
-    uint8_t low_byte = read(addr);
-    uint8_t high_byte = read(addr + 1);
-
-    decodePixels(low_byte, high_byte, out);
-    for (auto &pixel : out) {
-        pixel.bgp = 1;
-    }
+    low_byte = read(addr);
+    high_byte = read(addr + 1);
 }
 
-void PPU::fetchOBJLine(const Sprite &sprite, uint8_t curr_line, std::array<Pixel, 8> &out) {
+void PPU::fetchOBJBytes(const Sprite &sprite, uint8_t curr_line, uint8_t &low_byte, uint8_t &high_byte) {
     uint8_t obj_height = getOBJHeight();
     uint8_t adjusted_tile_num = sprite.tile_num;
 
@@ -365,8 +534,29 @@ void PPU::fetchOBJLine(const Sprite &sprite, uint8_t curr_line, std::array<Pixel
     }
 
     addr += sprite_line * 2;
-    uint8_t low_byte = read(addr);
-    uint8_t high_byte = read(addr + 1);
+    low_byte = read(addr);
+    high_byte = read(addr + 1);
+
+    // If sprite is horizontally flipped
+    if (sprite.flags & 0x20) {
+        low_byte = reverseBits(low_byte);
+        high_byte = reverseBits(high_byte);
+    }
+}
+
+void PPU::fetchTileLine(uint8_t tile_id, uint8_t tile_line, std::array<Pixel, 8> &out) {
+    uint8_t low_byte, high_byte;
+    fetchTileBytes(tile_id, tile_line, low_byte, high_byte);
+
+    decodePixels(low_byte, high_byte, out);
+    for (auto &pixel : out) {
+        pixel.bgp = 1;
+    }
+}
+
+void PPU::fetchOBJLine(const Sprite &sprite, uint8_t curr_line, std::array<Pixel, 8> &out) {
+    uint8_t low_byte, high_byte;
+    fetchOBJBytes(sprite, curr_line, low_byte, high_byte);
 
     decodePixels(low_byte, high_byte, out);
     for (auto &pixel : out) {
@@ -376,11 +566,6 @@ void PPU::fetchOBJLine(const Sprite &sprite, uint8_t curr_line, std::array<Pixel
             pixel.obp0 = 1;
         }
     }
-
-    // If sprite is horizontally flipped
-    if (sprite.flags & 0x20) {
-        std::reverse(std::begin(out), std::end(out));
-    }
 }
 
 void PPU::decodePixels(uint8_t low_byte, uint8_t high_byte, std::array<Pixel, 8> &out) {
@@ -398,26 +583,48 @@ void PPU::decodePixels(uint8_t low_byte, uint8_t high_byte, std::array<Pixel, 8>
     }
 }
 
-void PPU::drawLine() {
+void PPU::packLine() {
     for (uint8_t x = 0; x < SCREEN_WIDTH; x++) {
         Pixel pixel = pixel_line[x];
-        uint8_t palette;
-        if (pixel.bgp) {
-            palette = bgp;
-        } else if (pixel.obp0) {
-            palette = obp0;
-        } else if (pixel.obp1) {
-            palette = obp1;
-        }
 
-        COLOR color;
+        PALETTE palette;
         if (pixel.unlit) {
-            color = UNLIT;
+            palette = UNLIT_PALETTE;
+        } else if (pixel.obp0) {
+            palette = OBP0_PALETTE;
+        } else if (pixel.obp1) {
+            palette = OBP1_PALETTE;
         } else {
-            color = COLOR((palette >> (pixel.color * 2)) & 0x03);
+            palette = BG_PALETTE;
         }
 
-        this->driver->draw(color, x, ly);
+        line[x] = (palette << 2) | pixel.color;
+    }
+}
+
+void PPU::drawLine() {
+    std::array<uint8_t, SCREEN_WIDTH> colors;
+    std::array<uint32_t, SCREEN_WIDTH> argb;
+
+    for (uint8_t x = 0; x < SCREEN_WIDTH; x++) {
+        colors[x] = color_lut[line[x]];
+        argb[x] = argb_lut[line[x]];
+    }
+
+    if (ly < SCREEN_HEIGHT && colors != previous_lines[ly]) {
+        previous_lines[ly] = colors;
+        frame_changed = true;
+    }
+
+    this->driver->drawLine(colors.data(), argb.data(), ly);
+}
+
+void PPU::updatePalette(PALETTE palette, uint8_t value) {
+    for (uint8_t color = 0; color < 4; color++) {
+        COLOR shade = (palette == UNLIT_PALETTE) ? UNLIT : COLOR((value >> (color * 2)) & 0x03);
+
+        color_lut[(palette << 2) | color] = shade;
+        argb_lut[(palette << 2) | color] = driver->getARGBColor(shade);
     }
 }
 
@@ -499,6 +706,10 @@ void PPU::cpuWrite(uint16_t addr, uint8_t data) {
     }
 }
 
+void PPU::dmaTransfer(const uint8_t *src) {
+    std::copy(src, src + OAM_SIZE, oam.begin());
+}
+
 bool PPU::regRead(uint16_t addr, uint8_t &val) {
     switch(addr) {
         case LCDC: val = lcdc; break;
@@ -526,9 +737,9 @@ bool PPU::regWrite(uint16_t addr, uint8_t data) {
         case SCX:  scx = data;  break;
         case LY:   ly = 0;      break;
         case LYC:  lyc = data;  break;
-        case BGP:  bgp = data;  break;
-        case OBP0: obp0 = data; break;
-        case OBP1: obp1 = data; break;
+        case BGP:  bgp = data;  updatePalette(BG_PALETTE, bgp);    break;
+        case OBP0: obp0 = data; updatePalette(OBP0_PALETTE, obp0); break;
+        case OBP1: obp1 = data; updatePalette(OBP1_PALETTE, obp1); break;
         case WY:   wy = data;   break;
         case WX:   wx = data;   break;
         default:   return false;
@@ -556,6 +767,11 @@ void PPU::write(uint16_t addr, uint8_t data) {
      }
 }
 
+void PPU::setRenderInterval(uint32_t interval) {
+    // picked up at the start of the next frame, so the current one is drawn whole or not at all
+    render_interval = interval;
+}
+
 void PPU::connectBus(Bus *bus) {
     this->bus = bus;
 }
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "recording.h"
+
+// Run-length encoding: a control byte below 0x80 is followed by that many plus one literal
+// bytes, and one from 0x80 up is followed by a single byte repeated (control - 0x80 + 3) times
+#define RLE_MAX_LITERAL 128
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN (0x7F + RLE_MIN_RUN)
+
+static void compressRLE(const uint8_t *in, uint32_t size, std::vector<uint8_t> &out) {
+    uint32_t i = 0;
+
+    while (i < size) {
+        uint32_t run = 1;
+        while (i + run < size && run < RLE_MAX_RUN && in[i + run] == in[i]) {
+            run++;
+        }
+
+        if (run >= RLE_MIN_RUN) {
+            out.push_back(0x80 | (run - RLE_MIN_RUN));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+
+        // gather literals up to the next run worth encoding
+        uint32_t start = i;
+        while (i < size && i - start < RLE_MAX_LITERAL) {
+            if (i + 2 < size && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+                break;
+            }
+            i++;
+        }
+
+        out.push_back(i - start - 1);
+        out.insert(out.end(), &in[start], &in[i]);
+    }
+}
+
+// Returns false unless the data decodes to exactly out_size bytes
+static bool decompressRLE(const uint8_t *in, uint32_t size, uint8_t *out, uint32_t out_size) {
+    uint32_t i = 0;
+    uint32_t written = 0;
+
+    while (i < size) {
+        uint8_t control = in[i++];
+
+        if (control < 0x80) {
+            uint32_t count = control + 1;
+            if (i + count > size || written + count > out_size) {
+                return false;
+            }
+
+            std::memcpy(&out[written], &in[i], count);
+            i += count;
+            written += count;
+        } else {
+            uint32_t count = control - 0x80 + RLE_MIN_RUN;
+            if (i >= size || written + count > out_size) {
+                return false;
+            }
+
+            std::memset(&out[written], in[i++], count);
+            written += count;
+        }
+    }
+
+    return written == out_size;
+}
+
+// Packs four pixels per byte, first pixel in the low bits. UNLIT takes the unlit code
+static void packFrame(const uint8_t *frame, uint8_t unlit_code, uint8_t *packed) {
+    uint8_t unlit = (unlit_code < 4) ? unlit_code : 0;
+
+    for (uint32_t i = 0; i < PACKED_FRAME_SIZE; i++) {
+        uint8_t byte = 0;
+        for (uint32_t p = 0; p < 4; p++) {
+            uint8_t color = frame[i * 4 + p];
+            byte |= ((color == UNLIT) ? unlit : (color & 0x03)) << (p * 2);
+        }
+        packed[i] = byte;
+    }
+}
+
+static void unpackFrame(const uint8_t *packed, uint8_t unlit_code, uint8_t *frame) {
+    for (uint32_t i = 0; i < FRAME_PIXELS; i++) {
+        uint8_t code = (packed[i / 4] >> ((i % 4) * 2)) & 0x03;
+        frame[i] = (code == unlit_code) ? (uint8_t) UNLIT : code;
+    }
+}
+
+static void write16(std::ofstream &file, uint16_t value) {
+    uint8_t bytes[2] = {(uint8_t) value, (uint8_t) (value >> 8)};
+    file.write((const char *) bytes, 2);
+}
+
+static void write32(std::ofstream &file, uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+    file.write((const char *) bytes, 4);
+}
+
+static uint16_t read16(std::ifstream &file) {
+    uint8_t bytes[2] = {};
+    file.read((char *) bytes, 2);
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static uint32_t read32(std::ifstream &file) {
+    uint8_t bytes[4] = {};
+    file.read((char *) bytes, 4);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+FrameEncoder::FrameEncoder() {
+    previous.fill(WHITE);
+    current_packed.resize(PACKED_FRAME_SIZE);
+    previous_packed.resize(PACKED_FRAME_SIZE);
+}
+
+uint8_t FrameEncoder::encode(const uint8_t *frame, std::vector<uint8_t> &out) {
+    std::array<bool, UNLIT + 1> used = {};
+    for (uint32_t i = 0; i < FRAME_PIXELS; i++) {
+        used[std::min(frame[i], (uint8_t) UNLIT)] = true;
+    }
+
+    // UNLIT borrows the first shade the frame doesn't use
+    uint8_t unlit_code = UNLIT_NONE;
+    if (used[UNLIT]) {
+        unlit_code = UNLIT_FULL;
+
+        for (uint8_t shade = 0; shade < UNLIT; shade++) {
+            if (!used[shade]) {
+                unlit_code = shade;
+                break;
+            }
+        }
+    }
+
+    out.clear();
+
+    if (unlit_code == UNLIT_FULL) {
+        std::vector<uint8_t> diff(FRAME_PIXELS);
+        for (uint32_t i = 0; i < FRAME_PIXELS; i++) {
+            diff[i] = frame[i] ^ previous[i];
+        }
+
+        compressRLE(diff.data(), FRAME_PIXELS, out);
+    } else {
+        // the previous frame is packed the same way, so the decoder can repeat it exactly
+        packFrame(frame, unlit_code, current_packed.data());
+        packFrame(previous.data(), unlit_code, previous_packed.data());
+
+        for (uint32_t i = 0; i < PACKED_FRAME_SIZE; i++) {
+            current_packed[i] ^= previous_packed[i];
+        }
+
+        compressRLE(current_packed.data(), PACKED_FRAME_SIZE, out);
+    }
+
+    std::copy(frame, frame + FRAME_PIXELS, previous.begin());
+    return unlit_code;
+}
+
+FrameDecoder::FrameDecoder() {
+    previous.fill(WHITE);
+    previous_packed.resize(PACKED_FRAME_SIZE);
+}
+
+bool FrameDecoder::decode(const uint8_t *data, uint32_t size, uint8_t unlit_code) {
+    if (!size) {
+        // unchanged from the previous frame
+        return true;
+    }
+
+    if (unlit_code == UNLIT_FULL) {
+        diff.resize(FRAME_PIXELS);
+        if (!decompressRLE(data, size, diff.data(), FRAME_PIXELS)) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < FRAME_PIXELS; i++) {
+            previous[i] ^= diff[i];
+        }
+
+        return true;
+    }
+
+    if (unlit_code != UNLIT_NONE && unlit_code >= 4) {
+        return false;
+    }
+
+    diff.resize(PACKED_FRAME_SIZE);
+    if (!decompressRLE(data, size, diff.data(), PACKED_FRAME_SIZE)) {
+        return false;
+    }
+
+    packFrame(previous.data(), unlit_code, previous_packed.data());
+    for (uint32_t i = 0; i < PACKED_FRAME_SIZE; i++) {
+        previous_packed[i] ^= diff[i];
+    }
+
+    unpackFrame(previous_packed.data(), unlit_code, previous.data());
+    return true;
+}
+
+const uint8_t *FrameDecoder::getFrame() {
+    return previous.data();
+}
+
+RecordingWriter::RecordingWriter(const std::string &filename, uint32_t sample_rate) : file(filename, std::ios::binary) {
+    if (!file) {
+        throw std::runtime_error("Unable to open recording file " + filename + ".");
+    }
+
+    file.write(RECORDING_MAGIC, 4);
+    write16(file, RECORDING_VERSION);
+    write16(file, SCREEN_WIDTH);
+    write16(file, SCREEN_HEIGHT);
+    write32(file, sample_rate);
+}
+
+void RecordingWriter::writeFrame(const uint8_t *frame) {
+    uint8_t unlit_code = encoder.encode(frame, encoded);
+
+    file.put(RECORD_FRAME);
+    file.put(unlit_code);
+    write32(file, encoded.size());
+    file.write((const char *) encoded.data(), encoded.size());
+}
+
+void RecordingWriter::writeUnchangedFrame() {
+    file.put(RECORD_FRAME);
+    file.put(UNLIT_NONE);
+    write32(file, 0);
+}
+
+void RecordingWriter::writeAudio(const int16_t *samples, uint32_t count) {
+    file.put(RECORD_AUDIO);
+    write32(file, count);
+
+    // host byte order, which is little-endian on everything we build for
+    file.write((const char *) samples, count * 2 * sizeof(int16_t));
+}
+
+RecordingReader::RecordingReader(const std::string &filename) : file(filename, std::ios::binary) {
+    if (!file) {
+        throw std::runtime_error("Unable to open recording file " + filename + ".");
+    }
+
+    char magic[4] = {};
+    file.read(magic, 4);
+    uint16_t version = read16(file);
+    uint16_t width = read16(file);
+    uint16_t height = read16(file);
+    sample_rate = read32(file);
+
+    if (!file || std::memcmp(magic, RECORDING_MAGIC, 4) != 0 || version != RECORDING_VERSION) {
+        throw std::runtime_error(filename + " is not a supported recording.");
+    }
+
+    if (width != SCREEN_WIDTH || height != SCREEN_HEIGHT) {
+        throw std::runtime_error(filename + " has an unexpected frame size.");
+    }
+}
+
+uint32_t RecordingReader::getSampleRate() {
+    return sample_rate;
+}
+
+bool RecordingReader::next(RECORD_TYPE &type) {
+    int record = file.get();
+    if (record == std::char_traits<char>::eof()) {
+        return false;
+    }
+
+    switch (record) {
+        case RECORD_FRAME: {
+            uint8_t unlit_code = file.get();
+            uint32_t size = read32(file);
+
+            encoded.resize(size);
+            file.read((char *) encoded.data(), size);
+
+            if (!file || !decoder.decode(encoded.data(), size, unlit_code)) {
+                throw std::runtime_error("Corrupt frame in recording.");
+            }
+
+            type = RECORD_FRAME;
+            break;
+        }
+        case RECORD_AUDIO: {
+            uint32_t count = read32(file);
+
+            audio.resize(count * 2);
+            file.read((char *) audio.data(), count * 2 * sizeof(int16_t));
+
+            if (!file) {
+                throw std::runtime_error("Truncated audio in recording.");
+            }
+
+            type = RECORD_AUDIO;
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown record in recording.");
+    }
+
+    return true;
+}
+
+const uint8_t *RecordingReader::getFrame() {
+    return decoder.getFrame();
+}
+
+const std::vector<int16_t> &RecordingReader::getAudio() {
+    return audio;
+}
\ No newline at end of file
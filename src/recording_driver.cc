@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cmath>
+
+#include "recording_driver.h"
+
+RecordingDriver::RecordingDriver(GameboyDriver *driver, const std::string &filename)
+    : GameboyDriver(driver->sampling_rate), recording(filename, driver->sampling_rate) {
+    this->driver = driver;
+
+    capture = std::make_unique<Capture>();
+    frame.fill(WHITE);
+    done = false;
+    quit = false;
+
+    writer = std::thread(&RecordingDriver::writeLoop, this);
+}
+
+RecordingDriver::~RecordingDriver() {
+    // audio produced after the last frame still belongs in the recording
+    if (!capture->audio.empty()) {
+        handOff(false, false);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        done = true;
+    }
+
+    pending_cv.notify_one();
+    writer.join();
+}
+
+void RecordingDriver::drawLine(const uint8_t *colors, const uint32_t *argb, uint8_t y) {
+    if (y < SCREEN_HEIGHT) {
+        std::copy(colors, colors + SCREEN_WIDTH, &frame[y * SCREEN_WIDTH]);
+    }
+
+    driver->drawLine(colors, argb, y);
+}
+
+void RecordingDriver::render(bool frame_changed) {
+    handOff(true, frame_changed);
+    driver->render(frame_changed);
+}
+
+void RecordingDriver::pushSamples(const float *samples, uint32_t count) {
+    for (uint32_t i = 0; i < count * 2; i++) {
+        float sample = std::clamp(samples[i], -1.0F, 1.0F);
+        capture->audio.push_back(std::lround(sample * INT16_MAX));
+    }
+
+    driver->pushSamples(samples, count);
+}
+
+bool RecordingDriver::quitReceived() {
+    return driver->quitReceived();
+}
+
+ControllerState RecordingDriver::pollControls() {
+    return driver->pollControls();
+}
+
+double RecordingDriver::getRateAdjustment() {
+    return driver->getRateAdjustment();
+}
+
+uint32_t RecordingDriver::getRenderInterval() {
+    // every frame is recorded, however few the wrapped driver shows
+    return 1;
+}
+
+uint32_t RecordingDriver::getARGBColor(COLOR color) {
+    return driver->getARGBColor(color);
+}
+
+void RecordingDriver::handOff(bool has_frame, bool frame_changed) {
+    capture->has_frame = has_frame;
+    capture->frame_changed = frame_changed;
+
+    // unchanged frames go out as zero-size records, so there's nothing to copy
+    if (has_frame && frame_changed) {
+        capture->frame = frame;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.push_back(std::move(capture));
+    }
+
+    pending_cv.notify_one();
+    capture = std::make_unique<Capture>();
+}
+
+void RecordingDriver::writeLoop() {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+
+    while (true) {
+        pending_cv.wait(lock, [this] { return done || !pending.empty(); });
+
+        if (pending.empty()) {
+            // done, and everything has been written
+            return;
+        }
+
+        std::unique_ptr<Capture> next = std::move(pending.front());
+        pending.pop_front();
+
+        // encode and write without holding the lock so the emulation thread never waits on either
+        lock.unlock();
+        if (next->has_frame && next->frame_changed) {
+            recording.writeFrame(next->frame.data());
+        } else if (next->has_frame) {
+            recording.writeUnchangedFrame();
+        }
+        if (!next->audio.empty()) {
+            recording.writeAudio(next->audio.data(), next->audio.size() / 2);
+        }
+        lock.lock();
+    }
+}
\ No newline at end of file
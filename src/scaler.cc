@@ -0,0 +1,320 @@
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) && !defined(SCALAR_SCALER)
+#include <tmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "scaler.h"
+
+// The edge rules are written once against these, so the same code runs on a single pixel
+// or on a vector of 16. Masks are all ones where a comparison holds and zero elsewhere
+struct ScalarPixels {
+    typedef uint8_t Pixels;
+
+    static Pixels load(const uint8_t *p) { return *p; }
+    static Pixels eq(Pixels a, Pixels b) { return (a == b) ? 0xFF : 0x00; }
+    static Pixels ne(Pixels a, Pixels b) { return (a != b) ? 0xFF : 0x00; }
+    static Pixels both(Pixels a, Pixels b) { return a & b; }
+    static Pixels either(Pixels a, Pixels b) { return a | b; }
+    static Pixels select(Pixels mask, Pixels a, Pixels b) { return (a & mask) | (b & ~mask); }
+};
+
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+struct SSE2Pixels {
+    typedef __m128i Pixels;
+
+    static Pixels load(const uint8_t *p) { return _mm_loadu_si128((const __m128i *) p); }
+    static Pixels eq(Pixels a, Pixels b) { return _mm_cmpeq_epi8(a, b); }
+    static Pixels ne(Pixels a, Pixels b) { return _mm_xor_si128(_mm_cmpeq_epi8(a, b), _mm_set1_epi8(-1)); }
+    static Pixels both(Pixels a, Pixels b) { return _mm_and_si128(a, b); }
+    static Pixels either(Pixels a, Pixels b) { return _mm_or_si128(a, b); }
+    static Pixels select(Pixels mask, Pixels a, Pixels b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+};
+#endif
+
+// Neighbourhood of E, named as in the Scale2x/Scale3x descriptions
+//   A B C
+//   D E F
+//   G H I
+template <typename Ops>
+struct Neighbours {
+    typedef typename Ops::Pixels Pixels;
+
+    Pixels a, b, c, d, e, f, g, h, i;
+
+    // Loads the neighbourhood of x. Callers make sure x - 1 and x + 1 are in bounds
+    Neighbours(const uint8_t *above, const uint8_t *row, const uint8_t *below, uint32_t x) {
+        a = Ops::load(&above[x - 1]); b = Ops::load(&above[x]); c = Ops::load(&above[x + 1]);
+        d = Ops::load(&row[x - 1]);   e = Ops::load(&row[x]);   f = Ops::load(&row[x + 1]);
+        g = Ops::load(&below[x - 1]); h = Ops::load(&below[x]); i = Ops::load(&below[x + 1]);
+    }
+};
+
+// Fills out with the 2x2 block for E, left to right then top to bottom
+template <typename Ops>
+static void scale2xBlock(const Neighbours<Ops> &n, typename Ops::Pixels *out) {
+    // nothing changes unless E sits on an edge between two other colors
+    typename Ops::Pixels edge = Ops::both(Ops::ne(n.b, n.h), Ops::ne(n.d, n.f));
+
+    out[0] = Ops::select(Ops::both(edge, Ops::eq(n.d, n.b)), n.d, n.e);
+    out[1] = Ops::select(Ops::both(edge, Ops::eq(n.b, n.f)), n.f, n.e);
+    out[2] = Ops::select(Ops::both(edge, Ops::eq(n.d, n.h)), n.d, n.e);
+    out[3] = Ops::select(Ops::both(edge, Ops::eq(n.h, n.f)), n.f, n.e);
+}
+
+// Fills out with the 3x3 block for E, left to right then top to bottom
+template <typename Ops>
+static void scale3xBlock(const Neighbours<Ops> &n, typename Ops::Pixels *out) {
+    typedef typename Ops::Pixels Pixels;
+
+    Pixels edge = Ops::both(Ops::ne(n.b, n.h), Ops::ne(n.d, n.f));
+    Pixels db = Ops::both(edge, Ops::eq(n.d, n.b));
+    Pixels bf = Ops::both(edge, Ops::eq(n.b, n.f));
+    Pixels dh = Ops::both(edge, Ops::eq(n.d, n.h));
+    Pixels hf = Ops::both(edge, Ops::eq(n.h, n.f));
+
+    out[0] = Ops::select(db, n.d, n.e);
+    out[1] = Ops::select(Ops::either(Ops::both(db, Ops::ne(n.e, n.c)), Ops::both(bf, Ops::ne(n.e, n.a))), n.b, n.e);
+    out[2] = Ops::select(bf, n.f, n.e);
+    out[3] = Ops::select(Ops::either(Ops::both(db, Ops::ne(n.e, n.g)), Ops::both(dh, Ops::ne(n.e, n.a))), n.d, n.e);
+    out[4] = n.e;
+    out[5] = Ops::select(Ops::either(Ops::both(bf, Ops::ne(n.e, n.i)), Ops::both(hf, Ops::ne(n.e, n.c))), n.f, n.e);
+    out[6] = Ops::select(dh, n.d, n.e);
+    out[7] = Ops::select(Ops::either(Ops::both(dh, Ops::ne(n.e, n.i)), Ops::both(hf, Ops::ne(n.e, n.g))), n.h, n.e);
+    out[8] = Ops::select(hf, n.f, n.e);
+}
+
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+#if defined(__SSSE3__)
+// Byte shuffles taking output byte j of a 48 byte run from plane j % 3, pixel j / 3.
+// Bytes belonging to other planes are -1, which the shuffle zeroes
+typedef std::array<std::array<int8_t, 16>, 9> WeaveShuffles;
+
+static WeaveShuffles buildWeaveShuffles() {
+    WeaveShuffles shuffles;
+
+    for (uint32_t out = 0; out < 3; out++) {
+        for (uint32_t plane = 0; plane < 3; plane++) {
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t j = out * 16 + i;
+                shuffles[out * 3 + plane][i] = (j % 3 == plane) ? j / 3 : -1;
+            }
+        }
+    }
+
+    return shuffles;
+}
+#endif
+
+// Interleaves three vectors of 16 pixels into 48 bytes, p0 p1 p2 p0 p1 p2 ...
+static void weave3(const __m128i *planes, uint8_t *dst) {
+#if defined(__SSSE3__)
+    static const WeaveShuffles shuffles = buildWeaveShuffles();
+
+    for (uint32_t out = 0; out < 3; out++) {
+        __m128i woven = _mm_setzero_si128();
+        for (uint32_t plane = 0; plane < 3; plane++) {
+            __m128i shuffle = _mm_loadu_si128((const __m128i *) shuffles[out * 3 + plane].data());
+            woven = _mm_or_si128(woven, _mm_shuffle_epi8(planes[plane], shuffle));
+        }
+
+        _mm_storeu_si128((__m128i *) &dst[out * 16], woven);
+    }
+#else
+    // SSE2 can't shuffle bytes, so spill the planes and weave them one pixel at a time
+    alignas(16) uint8_t spilled[3][16];
+    for (uint32_t plane = 0; plane < 3; plane++) {
+        _mm_store_si128((__m128i *) spilled[plane], planes[plane]);
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t plane = 0; plane < 3; plane++) {
+            dst[i * 3 + plane] = spilled[plane][i];
+        }
+    }
+#endif
+}
+#endif
+
+// Writes the FACTOR x FACTOR block for pixel x, with the frame's edges repeated outwards
+template <uint32_t FACTOR>
+static void scalePixel(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+                       uint32_t x, uint32_t width, uint8_t **out) {
+    uint32_t left = x ? x - 1 : 0;
+    uint32_t right = (x + 1 < width) ? x + 1 : x;
+
+    // gather a clamped neighbourhood so Neighbours can load it at x = 1
+    uint8_t cols[3][3] = {{above[left], above[x], above[right]},
+                          {row[left], row[x], row[right]},
+                          {below[left], below[x], below[right]}};
+    Neighbours<ScalarPixels> n(cols[0], cols[1], cols[2], 1);
+
+    uint8_t block[FACTOR * FACTOR];
+    if constexpr (FACTOR == 2) {
+        scale2xBlock(n, block);
+    } else {
+        scale3xBlock(n, block);
+    }
+
+    for (uint32_t dy = 0; dy < FACTOR; dy++) {
+        for (uint32_t dx = 0; dx < FACTOR; dx++) {
+            out[dy][x * FACTOR + dx] = block[dy * FACTOR + dx];
+        }
+    }
+}
+
+template <uint32_t FACTOR>
+static void scaleEdges(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height) {
+    uint32_t out_width = width * FACTOR;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = &in[y * width];
+        const uint8_t *above = y ? row - width : row;
+        const uint8_t *below = (y + 1 < height) ? row + width : row;
+
+        uint8_t *out_rows[FACTOR];
+        for (uint32_t dy = 0; dy < FACTOR; dy++) {
+            out_rows[dy] = &out[(y * FACTOR + dy) * out_width];
+        }
+
+        // the first column needs its left neighbour clamped
+        scalePixel<FACTOR>(above, row, below, 0, width, out_rows);
+        uint32_t x = 1;
+
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+        // 16 pixels per pass, stopping short of the last column
+        for (; x + 16 < width; x += 16) {
+            Neighbours<SSE2Pixels> n(above, row, below, x);
+            __m128i block[FACTOR * FACTOR];
+
+            if constexpr (FACTOR == 2) {
+                scale2xBlock(n, block);
+
+                for (uint32_t dy = 0; dy < 2; dy++) {
+                    uint8_t *dst = &out_rows[dy][x * 2];
+                    _mm_storeu_si128((__m128i *) &dst[0], _mm_unpacklo_epi8(block[dy * 2], block[dy * 2 + 1]));
+                    _mm_storeu_si128((__m128i *) &dst[16], _mm_unpackhi_epi8(block[dy * 2], block[dy * 2 + 1]));
+                }
+            } else {
+                scale3xBlock(n, block);
+
+                for (uint32_t dy = 0; dy < FACTOR; dy++) {
+                    weave3(&block[dy * FACTOR], &out_rows[dy][x * FACTOR]);
+                }
+            }
+        }
+#endif
+
+        for (; x < width; x++) {
+            scalePixel<FACTOR>(above, row, below, x, width, out_rows);
+        }
+    }
+}
+
+// Repeats each pixel of a row two, three or four times
+static void widenRow2(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    uint32_t x = 0;
+
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+    for (; x + 16 <= width; x += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) &src[x]);
+        _mm_storeu_si128((__m128i *) &dst[x * 2], _mm_unpacklo_epi8(pixels, pixels));
+        _mm_storeu_si128((__m128i *) &dst[x * 2 + 16], _mm_unpackhi_epi8(pixels, pixels));
+    }
+#endif
+
+    for (; x < width; x++) {
+        dst[x * 2] = dst[x * 2 + 1] = src[x];
+    }
+}
+
+static void widenRow3(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    uint32_t x = 0;
+
+#if defined(__SSSE3__) && !defined(SCALAR_SCALER)
+    // one byte shuffle per output vector. Only used when building with SSSE3 enabled
+    const __m128i spread[3] = {
+        _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5),
+        _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10),
+        _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15),
+    };
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) &src[x]);
+        for (uint32_t i = 0; i < 3; i++) {
+            _mm_storeu_si128((__m128i *) &dst[x * 3 + i * 16], _mm_shuffle_epi8(pixels, spread[i]));
+        }
+    }
+#elif !defined(SCALAR_SCALER) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // SWAR: multiplying a pixel by 0x010101 repeats it three times in one word. The word's
+    // spare byte lands on the next pixel's first byte, which that pixel then overwrites
+    for (; x + 1 < width; x++) {
+        uint32_t word = src[x] * 0x010101;
+        std::memcpy(&dst[x * 3], &word, sizeof(word));
+    }
+#endif
+
+    for (; x < width; x++) {
+        dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+    }
+}
+
+static void widenRow4(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    uint32_t x = 0;
+
+#if defined(__SSE2__) && !defined(SCALAR_SCALER)
+    for (; x + 16 <= width; x += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) &src[x]);
+        __m128i lo = _mm_unpacklo_epi8(pixels, pixels);
+        __m128i hi = _mm_unpackhi_epi8(pixels, pixels);
+
+        _mm_storeu_si128((__m128i *) &dst[x * 4], _mm_unpacklo_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *) &dst[x * 4 + 16], _mm_unpackhi_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *) &dst[x * 4 + 32], _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i *) &dst[x * 4 + 48], _mm_unpackhi_epi16(hi, hi));
+    }
+#endif
+
+    for (; x < width; x++) {
+        std::fill(&dst[x * 4], &dst[x * 4 + 4], src[x]);
+    }
+}
+
+void scaleNearest(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height, uint32_t factor) {
+    uint32_t out_width = width * factor;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = &in[y * width];
+        uint8_t *dst = &out[y * factor * out_width];
+
+        switch (factor) {
+            case 2:  widenRow2(src, dst, width); break;
+            case 3:  widenRow3(src, dst, width); break;
+            case 4:  widenRow4(src, dst, width); break;
+            default:
+                for (uint32_t x = 0; x < width; x++) {
+                    std::fill(&dst[x * factor], &dst[(x + 1) * factor], src[x]);
+                }
+                break;
+        }
+
+        // the rest of the block's rows repeat the first
+        for (uint32_t dy = 1; dy < factor; dy++) {
+            std::memcpy(&dst[dy * out_width], dst, out_width);
+        }
+    }
+}
+
+void scale2x(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height) {
+    scaleEdges<2>(in, out, width, height);
+}
+
+void scale3x(const uint8_t *in, uint8_t *out, uint32_t width, uint32_t height) {
+    scaleEdges<3>(in, out, width, height);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "scanline.h"
+
+// spread[b] holds 8 bytes, one per bit of b (MSB first), each either 0 or 1
+static std::array<uint64_t, 256> buildSpreadTable() {
+    std::array<uint64_t, 256> table;
+
+    for (uint16_t b = 0; b < 256; b++) {
+        uint8_t bytes[8];
+        for (uint8_t i = 0; i < 8; i++) {
+            bytes[i] = (b >> (7 - i)) & 0x01;
+        }
+
+        std::memcpy(&table[b], bytes, sizeof(bytes));
+    }
+
+    return table;
+}
+
+static const std::array<uint64_t, 256> spread = buildSpreadTable();
+
+Plane planeFromBytes(const uint8_t *bytes, uint8_t skip) {
+    Plane plane;
+
+    for (uint8_t k = 0; k < PLANE_WORDS; k++) {
+        uint64_t word = 0;
+        for (uint8_t i = 0; i < 8; i++) {
+            word = (word << 8) | bytes[k * 8 + i];
+        }
+
+        plane.w[k] = word;
+    }
+
+    if (skip) {
+        for (uint8_t k = 0; k < PLANE_WORDS; k++) {
+            uint64_t next = (k + 1 < PLANE_WORDS) ? plane.w[k + 1] : 0;
+            plane.w[k] = (plane.w[k] << skip) | (next >> (64 - skip));
+        }
+    }
+
+    return plane;
+}
+
+Plane planeShiftRight(const Plane &plane, uint8_t pixels) {
+    Plane out = {};
+    uint8_t words = pixels / 64;
+    uint8_t bits = pixels % 64;
+
+    for (int8_t k = PLANE_WORDS - 1; k >= words; k--) {
+        out.w[k] = plane.w[k - words] >> bits;
+
+        if (bits && k - words - 1 >= 0) {
+            out.w[k] |= plane.w[k - words - 1] << (64 - bits);
+        }
+    }
+
+    return out;
+}
+
+Plane planeRange(uint8_t start, uint8_t end) {
+    Plane out = {};
+
+    for (uint8_t k = 0; k < PLANE_WORDS; k++) {
+        int16_t first = std::max<int16_t>(start, k * 64) - k * 64;
+        int16_t last = std::min<int16_t>(end, (k + 1) * 64) - k * 64;
+
+        if (last > first) {
+            uint64_t ones = (last - first == 64) ? ~0ULL : ((1ULL << (last - first)) - 1);
+            out.w[k] = ones << (64 - last);
+        }
+    }
+
+    return out;
+}
+
+void planePlaceByte(Plane &plane, int16_t x, uint8_t byte) {
+    if (x <= -8 || x >= PLANE_WORDS * 64) {
+        return;
+    }
+
+    // Drop pixels hanging off the left edge
+    if (x < 0) {
+        byte <<= -x;
+        x = 0;
+    }
+
+    uint8_t k = x / 64;
+    uint8_t offset = x % 64;
+
+    if (offset <= 56) {
+        plane.w[k] |= (uint64_t) byte << (56 - offset);
+    } else {
+        plane.w[k] |= byte >> (offset - 56);
+        if (k + 1 < PLANE_WORDS) {
+            plane.w[k + 1] |= (uint64_t) byte << (120 - offset);
+        }
+    }
+}
+
+void planeUnpack(const Plane &p0, const Plane &p1, const Plane &p2, const Plane &p3,
+                 uint8_t *out, uint8_t num_pixels) {
+    for (uint8_t group = 0; group < num_pixels / 8; group++) {
+        uint8_t k = group / 8;
+        uint8_t shift = 56 - (group % 8) * 8;
+
+        uint64_t pixels = (spread[(p0.w[k] >> shift) & 0xFF] << 0) |
+                          (spread[(p1.w[k] >> shift) & 0xFF] << 1) |
+                          (spread[(p2.w[k] >> shift) & 0xFF] << 2) |
+                          (spread[(p3.w[k] >> shift) & 0xFF] << 3);
+
+        std::memcpy(out + group * 8, &pixels, sizeof(pixels));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "bus.h"
+#include "interrupt.h"
+#include "serial.h"
+
+// SC bits
+#define SC_TRANSFER 0x80
+#define SC_INTERNAL_CLOCK 0x01
+#define SC_UNUSED 0x7E
+
+Serial::Serial() {
+    linked = false;
+    capture_enabled = false;
+    bus = nullptr;
+
+    reset();
+}
+
+void Serial::clock(uint8_t cycles) {
+    if (!transfer_cycles) {
+        return;
+    }
+
+    transfer_cycles -= std::min((uint32_t) cycles, transfer_cycles);
+
+    // nothing on the other end, so the input line stays high
+    if (!transfer_cycles && !linked) {
+        completeTransfer(0xFF);
+    }
+}
+
+void Serial::reset() {
+    sb = 0x00;
+    sc = 0x00;
+    transfer_cycles = 0;
+    captured_output.clear();
+}
+
+bool Serial::regWrite(uint16_t addr, uint8_t data) {
+    switch(addr) {
+        case SB: sb = data; break;
+        case SC:
+            sc = data & (SC_TRANSFER | SC_INTERNAL_CLOCK);
+
+            // An external clock is driven by the other side, so only internal transfers count down
+            transfer_cycles = isClockingInternally() ? SERIAL_TRANSFER_CYCLES : 0;
+
+            if (capture_enabled && isClockingInternally()) {
+                captured_output.push_back(sb);
+            }
+            break;
+        default:  return false;
+    }
+
+    return true;
+}
+
+bool Serial::regRead(uint16_t addr, uint8_t &val) {
+    switch(addr) {
+        case SB: val = sb; break;
+        case SC: val = sc | SC_UNUSED; break;
+        default: return false;
+    }
+
+    return true;
+}
+
+void Serial::connectBus(Bus *bus) {
+    this->bus = bus;
+}
+
+void Serial::setLinked(bool linked) {
+    this->linked = linked;
+}
+
+void Serial::setCaptureEnabled(bool enabled) {
+    capture_enabled = enabled;
+}
+
+const std::vector<uint8_t> &Serial::getCapturedOutput() {
+    return captured_output;
+}
+
+uint32_t Serial::getCyclesUntilTransfer() {
+    return isClockingInternally() ? transfer_cycles : SERIAL_NO_TRANSFER;
+}
+
+bool Serial::isTransferDue() {
+    return isClockingInternally() && !transfer_cycles;
+}
+
+uint8_t Serial::getOutgoing() {
+    return sb;
+}
+
+void Serial::completeTransfer(uint8_t incoming) {
+    sb = incoming;
+    sc &= ~SC_TRANSFER;
+    transfer_cycles = 0;
+
+    bus->requestInterrupt(INTERRUPT::SERIAL);
+}
+
+uint8_t Serial::receiveExternal(uint8_t incoming) {
+    if ((sc & (SC_TRANSFER | SC_INTERNAL_CLOCK)) != SC_TRANSFER) {
+        return 0xFF;
+    }
+
+    uint8_t outgoing = sb;
+    completeTransfer(incoming);
+
+    return outgoing;
+}
+
+bool Serial::isClockingInternally() {
+    return (sc & (SC_TRANSFER | SC_INTERNAL_CLOCK)) == (SC_TRANSFER | SC_INTERNAL_CLOCK);
+}
\ No newline at end of file
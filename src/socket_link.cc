@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_link.h"
+
+// type, data, u64 little-endian time
+#define MESSAGE_SIZE 10
+
+// Connecting retries for a while so either side can be started first
+#define CONNECT_ATTEMPTS 50
+#define CONNECT_RETRY_DELAY 100 // ms
+
+// Waiting on the other side wakes up this often to check for a quit
+#define RECEIVE_TIMEOUT 100 // ms
+
+#define UNIX_PREFIX "unix:"
+
+
+static int openUnixSocket(LINK_ROLE role, const std::string &path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path " + path + " is too long.");
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create socket " + path + ".");
+    }
+
+    if (role == LINK_LISTEN) {
+        // a stale socket file left behind by an earlier run would fail the bind
+        unlink(path.c_str());
+
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+            close(fd);
+            throw std::runtime_error("Unable to listen on " + path + ".");
+        }
+
+        int connection = accept(fd, nullptr, nullptr);
+        close(fd);
+        unlink(path.c_str());
+
+        if (connection < 0) {
+            throw std::runtime_error("Unable to accept a link on " + path + ".");
+        }
+        return connection;
+    }
+
+    for (uint32_t attempt = 0; connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0; attempt++) {
+        if (attempt + 1 == CONNECT_ATTEMPTS) {
+            close(fd);
+            throw std::runtime_error("Unable to connect to " + path + ".");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_DELAY));
+    }
+
+    return fd;
+}
+
+static int openTCPSocket(LINK_ROLE role, const std::string &address) {
+    size_t colon = address.find_last_of(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("Link address " + address + " needs a port.");
+    }
+
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = (role == LINK_LISTEN) ? AI_PASSIVE : 0;
+
+    addrinfo *info;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &info) != 0) {
+        throw std::runtime_error("Unable to resolve " + address + ".");
+    }
+
+    int fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(info);
+        throw std::runtime_error("Unable to create socket for " + address + ".");
+    }
+
+    int connection = -1;
+    if (role == LINK_LISTEN) {
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(fd, info->ai_addr, info->ai_addrlen) == 0 && listen(fd, 1) == 0) {
+            connection = accept(fd, nullptr, nullptr);
+        }
+        close(fd);
+    } else {
+        for (uint32_t attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++) {
+            if (connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+                connection = fd;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_DELAY));
+        }
+
+        if (connection < 0) {
+            close(fd);
+        }
+    }
+
+    freeaddrinfo(info);
+
+    if (connection < 0) {
+        throw std::runtime_error("Unable to link over " + address + ".");
+    }
+
+    // messages are tiny and every one of them is waited on
+    int no_delay = 1;
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    return connection;
+}
+
+SocketLink::SocketLink(Bus *bus, LINK_ROLE role, const std::string &address, uint32_t window) {
+    this->bus = bus;
+    this->window = std::max(window, (uint32_t) 1);
+
+    if (address.compare(0, std::strlen(UNIX_PREFIX), UNIX_PREFIX) == 0) {
+        fd = openUnixSocket(role, address.substr(std::strlen(UNIX_PREFIX)));
+    } else {
+        fd = openTCPSocket(role, address);
+    }
+
+    time = 0;
+    peer_time = 0;
+    peer_transfer = {0, 0};
+    peer_transferring = false;
+    announced_time = 0;
+    announced = false;
+    replied = false;
+    reply = 0xFF;
+    transfer_count = 0;
+
+    bus->getSerial().setLinked(true);
+}
+
+SocketLink::~SocketLink() {
+    disconnect();
+}
+
+void SocketLink::run() {
+    Serial &serial = bus->getSerial();
+
+    while (!bus->quitReceived()) {
+        if (fd < 0) {
+            bus->run();
+            return;
+        }
+
+        receive(false);
+        answerTransfer();
+
+        // stop at the edge of the window, when the next transfer on either side finishes,
+        // or after a transfer's length so one started along the way is announced in time
+        uint64_t target = std::min(peer_time + window, time + SERIAL_TRANSFER_CYCLES);
+        if (peer_transferring) {
+            target = std::min(target, peer_transfer.time);
+        }
+
+        uint32_t remaining = serial.getCyclesUntilTransfer();
+        if (remaining != SERIAL_NO_TRANSFER) {
+            target = std::min(target, time + remaining);
+        }
+
+        if (serial.isTransferDue()) {
+            finishTransfer();
+            continue;
+        }
+
+        if (target <= time) {
+            // as far ahead as we're allowed, so wait to hear more
+            receive(true);
+            continue;
+        }
+
+        time += bus->runFor(target - time);
+
+        announceTransfer();
+        send(MESSAGE_TIME, 0, time);
+    }
+}
+
+uint64_t SocketLink::getTransferCount() {
+    return transfer_count;
+}
+
+void SocketLink::send(MESSAGE type, uint8_t data, uint64_t time) {
+    if (fd < 0) {
+        return;
+    }
+
+    uint8_t bytes[MESSAGE_SIZE] = {(uint8_t) type, data};
+    for (uint32_t i = 0; i < 8; i++) {
+        bytes[2 + i] = time >> (i * 8);
+    }
+
+    if (::send(fd, bytes, MESSAGE_SIZE, MSG_NOSIGNAL) != MESSAGE_SIZE) {
+        disconnect();
+    }
+}
+
+bool SocketLink::receive(bool wait) {
+    if (fd < 0) {
+        return false;
+    }
+
+    pollfd poll_fd = {fd, POLLIN, 0};
+    while (poll(&poll_fd, 1, wait ? RECEIVE_TIMEOUT : 0) > 0) {
+        uint8_t bytes[MESSAGE_SIZE];
+        if (recv(fd, bytes, MESSAGE_SIZE, MSG_WAITALL) != MESSAGE_SIZE) {
+            disconnect();
+            return false;
+        }
+
+        Message message = {MESSAGE(bytes[0]), bytes[1], 0};
+        for (uint32_t i = 0; i < 8; i++) {
+            message.time |= (uint64_t) bytes[2 + i] << (i * 8);
+        }
+
+        switch (message.type) {
+            case MESSAGE_TIME: peer_time = std::max(peer_time, message.time); break;
+            case MESSAGE_TRANSFER:
+                peer_transfer = {message.time, message.data};
+                peer_transferring = true;
+                break;
+            case MESSAGE_CANCEL:
+                if (peer_transferring && peer_transfer.time == message.time) {
+                    peer_transferring = false;
+                }
+                break;
+            case MESSAGE_REPLY:
+                // a reply to a transfer that SC has since moved or stopped is stale
+                if (announced && message.time == announced_time) {
+                    reply = message.data;
+                    replied = true;
+                }
+                break;
+            default:
+                disconnect();
+                return false;
+        }
+
+        // once something has arrived, only take what's already waiting
+        wait = false;
+    }
+
+    return true;
+}
+
+void SocketLink::answerTransfer() {
+    // wait until the other side has run to the finish as well, so a cancel or restart
+    // of the transfer before then is always heard first
+    if (peer_transferring && peer_transfer.time <= time && peer_transfer.time <= peer_time) {
+        send(MESSAGE_REPLY, bus->getSerial().receiveExternal(peer_transfer.data), peer_transfer.time);
+        peer_transferring = false;
+        transfer_count++;
+    }
+}
+
+void SocketLink::announceTransfer() {
+    Serial &serial = bus->getSerial();
+
+    // a due transfer has already finished shifting, and the run may have overshot its finish
+    if (announced && serial.isTransferDue()) {
+        return;
+    }
+
+    uint32_t remaining = serial.getCyclesUntilTransfer();
+    if (remaining == SERIAL_NO_TRANSFER) {
+        if (announced) {
+            send(MESSAGE_CANCEL, 0, announced_time);
+            announced = false;
+            replied = false;
+        }
+        return;
+    }
+
+    // writing SC again restarts the transfer, moving its finish
+    if (announced && announced_time == time + remaining) {
+        return;
+    }
+
+    announced_time = time + remaining;
+    send(MESSAGE_TRANSFER, serial.getOutgoing(), announced_time);
+    announced = true;
+    replied = false;
+}
+
+void SocketLink::finishTransfer() {
+    // we're stopped at the finish, so the other side may run up to it and answer
+    send(MESSAGE_TIME, 0, time);
+
+    while (!replied && fd >= 0 && !bus->quitReceived()) {
+        answerTransfer();
+        receive(true);
+    }
+
+    announced = false;
+
+    if (!replied) {
+        // unplugged or quit while waiting, so nothing was shifted in
+        if (bus->getSerial().isTransferDue()) {
+            bus->getSerial().completeTransfer(0xFF);
+        }
+        return;
+    }
+
+    bus->getSerial().completeTransfer(reply);
+    replied = false;
+    transfer_count++;
+}
+
+void SocketLink::disconnect() {
+    if (fd < 0) {
+        return;
+    }
+
+    close(fd);
+    fd = -1;
+    peer_transferring = false;
+
+    Serial &serial = bus->getSerial();
+    serial.setLinked(false);
+    if (serial.isTransferDue()) {
+        serial.completeTransfer(0xFF);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "bus.h"
+#include "headless_gb_driver.h"
+
+#ifndef GB_DEBUGGER
+#error "gb-debug needs the core built with GB_DEBUGGER (gb-core-debug)"
+#endif
+
+// Continue hands back the prompt after a second of emulation if nothing stops it
+#define CONTINUE_CYCLES (70224 * 60)
+
+static uint16_t parseAddress(const std::string &text) {
+    return std::stoul(text, nullptr, 16);
+}
+
+static void printRegisters(Bus &bus) {
+    CPU::REGISTERS regs = bus.getCPURegisters();
+
+    char line[96];
+    std::snprintf(line, sizeof(line), "AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X PC=%04X",
+                  regs.af, regs.bc, regs.de, regs.hl, regs.sp, regs.pc);
+    std::cout << line << std::endl;
+}
+
+static void printStop(Bus &bus) {
+    Debugger &debugger = bus.getDebugger();
+
+    char line[64];
+    switch (debugger.getStopReason()) {
+        case STOP_BREAKPOINT:
+            std::snprintf(line, sizeof(line), "Breakpoint at %04X", debugger.getStopAddress());
+            break;
+        case STOP_WATCH_READ:
+            std::snprintf(line, sizeof(line), "Read %02X from %04X", debugger.getStopValue(), debugger.getStopAddress());
+            break;
+        case STOP_WATCH_WRITE:
+            std::snprintf(line, sizeof(line), "Write %02X to %04X", debugger.getStopValue(), debugger.getStopAddress());
+            break;
+        case STOP_STEP:
+            std::snprintf(line, sizeof(line), "Stepped to %04X", debugger.getStopAddress());
+            break;
+        default:
+            std::snprintf(line, sizeof(line), "Still running after a second of emulation");
+            break;
+    }
+
+    std::cout << line << std::endl;
+    printRegisters(bus);
+}
+
+static void printMemory(Bus &bus, uint16_t addr, uint32_t length) {
+    for (uint32_t row = 0; row < length; row += 16) {
+        char line[80];
+        int written = std::snprintf(line, sizeof(line), "%04X:", (uint16_t) (addr + row));
+
+        for (uint32_t i = row; i < length && i < row + 16; i++) {
+            written += std::snprintf(line + written, sizeof(line) - written, " %02X", bus.cpuRead(addr + i));
+        }
+        std::cout << line << std::endl;
+    }
+}
+
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cout << "Usage: " << argv[0] << " rom_file" << std::endl;
+        std::cout << "Commands, with addresses in hex:" << std::endl;
+        std::cout << "  b addr        set a breakpoint       d addr        delete a breakpoint" << std::endl;
+        std::cout << "  w addr [r|w]  watch reads/writes     u addr        unwatch" << std::endl;
+        std::cout << "  s [count]     step instructions      c             continue" << std::endl;
+        std::cout << "  r             show registers         x addr [len]  show memory" << std::endl;
+        std::cout << "  q             quit" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    HeadlessGameboyDriver driver;
+
+    Bus bus(&driver);
+    bus.insertCartridge(std::make_shared<Cartridge>(std::string(argv[1])));
+    bus.setAudioEnabled(false);
+
+    Debugger &debugger = bus.getDebugger();
+
+    // start stopped at the first instruction
+    debugger.step(0);
+    bus.runFor(1);
+    printStop(bus);
+
+    std::string input;
+    while (std::cout << "> " << std::flush, std::getline(std::cin, input)) {
+        std::istringstream line(input);
+        std::string command, arg1, arg2;
+        line >> command >> arg1 >> arg2;
+
+        try {
+            if (command == "b") {
+                debugger.addBreakpoint(parseAddress(arg1));
+            } else if (command == "d") {
+                debugger.removeBreakpoint(parseAddress(arg1));
+            } else if (command == "w") {
+                WATCH_TYPE type = (arg2 == "r") ? WATCH_READ : (arg2 == "w") ? WATCH_WRITE : WATCH_ACCESS;
+                debugger.addWatchpoint(parseAddress(arg1), type);
+            } else if (command == "u") {
+                debugger.removeWatchpoint(parseAddress(arg1));
+            } else if (command == "s") {
+                debugger.step(arg1.empty() ? 1 : std::stoul(arg1));
+                while (!debugger.isStopped()) {
+                    bus.runFor(CONTINUE_CYCLES);
+                }
+                printStop(bus);
+            } else if (command == "c") {
+                debugger.resume();
+                bus.runFor(CONTINUE_CYCLES);
+                printStop(bus);
+            } else if (command == "r") {
+                printRegisters(bus);
+            } else if (command == "x") {
+                printMemory(bus, parseAddress(arg1), arg2.empty() ? 16 : std::stoul(arg2));
+            } else if (command == "q") {
+                break;
+            } else if (!command.empty()) {
+                std::cout << "Unknown command " << command << std::endl;
+            }
+        } catch (const std::logic_error &) {
+            std::cout << "Bad argument" << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_capture_driver.h"
+#include "bus.h"
+#include "headless_gb_driver.h"
+#include "recording_driver.h"
+
+#define DEFAULT_FRAMES 3600
+
+// How often the serial output is checked for a test result, about once a frame
+#define RESULT_CHECK_CYCLES 70224
+
+enum TEST_RESULT {TEST_RUNNING, TEST_PASSED, TEST_FAILED};
+
+
+// Watches serial output for the results test ROMs print. Blargg's tests print a line with
+// "Passed" or "Failed", and mooneye's send the Fibonacci bytes 3 5 8 13 21 34 to pass or
+// six 0x42s to fail. Only output that's new since the last call is scanned
+class TestResultScanner {
+    public:
+        TEST_RESULT scan(const std::vector<uint8_t> &output) {
+            static const std::vector<uint8_t> mooneye_passed = {3, 5, 8, 13, 21, 34};
+            static const std::vector<uint8_t> mooneye_failed = {0x42, 0x42, 0x42, 0x42, 0x42, 0x42};
+
+            for (; scanned < output.size(); scanned++) {
+                if (endsWith(output, scanned + 1, mooneye_passed)) {
+                    return TEST_PASSED;
+                }
+                if (endsWith(output, scanned + 1, mooneye_failed)) {
+                    return TEST_FAILED;
+                }
+
+                // wait for the end of the line, so the failure details come along with it
+                if (output[scanned] == '\n') {
+                    std::string line(output.begin() + line_start, output.begin() + scanned);
+                    line_start = scanned + 1;
+
+                    if (line.find("Failed") != std::string::npos) {
+                        scanned++;
+                        return TEST_FAILED;
+                    }
+                    if (line.find("Passed") != std::string::npos) {
+                        scanned++;
+                        return TEST_PASSED;
+                    }
+                }
+            }
+
+            return TEST_RUNNING;
+        }
+
+    private:
+        static bool endsWith(const std::vector<uint8_t> &output, size_t end, const std::vector<uint8_t> &pattern) {
+            return end >= pattern.size() && std::equal(pattern.begin(), pattern.end(), output.begin() + end - pattern.size());
+        }
+
+        size_t scanned = 0;
+        size_t line_start = 0;
+};
+
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 5) {
+        std::cout << "Usage: " << argv[0] << " rom_file [frames] [output_file|-] [render_interval]" << std::endl;
+        std::cout << "Audio is only generated when output_file is given. Files ending in .gbr record video and audio," << std::endl;
+        std::cout << ".wav files get WAV audio and anything else gets raw PCM audio" << std::endl;
+        std::cout << "Only every render_interval-th frame is drawn (0 draws none), for bulk runs that don't need every frame" << std::endl;
+        std::cout << "Test ROMs that report a result over the serial port stop early, failures with a nonzero exit" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint32_t frames = (argc >= 3) ? std::stoul(argv[2]) : DEFAULT_FRAMES;
+    uint32_t render_interval = (argc == 5) ? std::stoul(argv[4]) : 1;
+
+    std::shared_ptr<Cartridge> cart = std::make_shared<Cartridge>(std::string(argv[1]));
+    HeadlessGameboyDriver driver = HeadlessGameboyDriver(frames);
+
+    std::unique_ptr<GameboyDriver> capture;
+    if (argc >= 4 && std::string(argv[3]) != "-") {
+        std::string output_filename = std::string(argv[3]);
+        auto hasExtension = [&output_filename](const std::string &extension) {
+            return output_filename.size() >= extension.size() &&
+                   output_filename.substr(output_filename.size() - extension.size()) == extension;
+        };
+
+        if (hasExtension(".gbr")) {
+            capture = std::make_unique<RecordingDriver>(&driver, output_filename);
+        } else {
+            capture = std::make_unique<AudioCaptureDriver>(&driver, output_filename, hasExtension(".wav") ? CAPTURE_WAV : CAPTURE_RAW);
+        }
+    }
+
+    Bus bus(capture ? capture.get() : &driver);
+    bus.insertCartridge(cart);
+    bus.setRenderInterval(render_interval);
+
+    // nobody is listening unless we're capturing
+    bus.setAudioEnabled((bool) capture);
+
+    // test ROMs print their results over the serial port, usually long before the frame limit
+    bus.setSerialCapture(true);
+
+    TestResultScanner scanner;
+    TEST_RESULT result = TEST_RUNNING;
+    while (!bus.quitReceived() && result == TEST_RUNNING) {
+        bus.runFor(RESULT_CHECK_CYCLES);
+        result = scanner.scan(bus.getSerialOutput());
+    }
+
+    // flush any audio that hasn't been synthesized yet, then finish the file
+    bus.flushAudio();
+    capture.reset();
+
+    const std::vector<uint8_t> &serial_output = bus.getSerialOutput();
+    if (!serial_output.empty()) {
+        // mooneye's results aren't text, so show anything unprintable as hex
+        std::cout << "Serial output:" << std::endl;
+        for (uint8_t byte : serial_output) {
+            if (byte == '\n' || (byte >= 0x20 && byte < 0x7F)) {
+                std::cout << (char) byte;
+            } else {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\x%02X", byte);
+                std::cout << escaped;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << driver.getFrameCount() << " frames, last frame " << std::hex << driver.getFrameHash() << std::endl;
+
+    if (result != TEST_RUNNING) {
+        std::cout << ((result == TEST_PASSED) ? "Passed" : "Failed") << std::endl;
+    }
+
+    return (result == TEST_FAILED) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "bus.h"
+#include "headless_gb_driver.h"
+#include "link_cable.h"
+
+#define DEFAULT_FRAMES 3600
+
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 5) {
+        std::cout << "Usage: " << argv[0] << " first_rom_file second_rom_file [frames] [threaded|single]" << std::endl;
+        std::cout << "Runs two linked machines without a window or audio" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint32_t frames = (argc >= 4) ? std::stoul(argv[3]) : DEFAULT_FRAMES;
+
+    bool threaded = std::thread::hardware_concurrency() > 1;
+    if (argc == 5) {
+        threaded = std::string(argv[4]) == "threaded";
+    }
+
+    HeadlessGameboyDriver first_driver = HeadlessGameboyDriver(frames);
+    HeadlessGameboyDriver second_driver = HeadlessGameboyDriver(frames);
+
+    Bus first(&first_driver);
+    Bus second(&second_driver);
+    first.insertCartridge(std::make_shared<Cartridge>(std::string(argv[1])));
+    second.insertCartridge(std::make_shared<Cartridge>(std::string(argv[2])));
+
+    first.setAudioEnabled(false);
+    second.setAudioEnabled(false);
+
+    LinkCable cable(&first, &second);
+
+    auto start = std::chrono::steady_clock::now();
+    cable.run(threaded);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << first_driver.getFrameCount() << " and " << second_driver.getFrameCount() << " frames in "
+              << elapsed.count() << " s (" << (threaded ? "threaded" : "single thread") << "), "
+              << cable.getTransferCount() << " bytes transferred" << std::endl;
+    std::cout << "last frames " << std::hex << first_driver.getFrameHash() << " " << second_driver.getFrameHash() << std::endl;
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
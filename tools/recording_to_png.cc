@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "headless_gb_driver.h"
+#include "recording.h"
+
+typedef std::array<uint32_t, 256> CRCTable;
+
+static CRCTable buildCRCTable() {
+    CRCTable table;
+
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (uint32_t k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+
+    return table;
+}
+
+static void writeBE32(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void writeChunk(std::ofstream &file, const char *type, const std::vector<uint8_t> &data) {
+    static const CRCTable crc_table = buildCRCTable();
+
+    std::vector<uint8_t> chunk;
+    writeBE32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+
+    // the CRC covers the type and data but not the length
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 4; i < chunk.size(); i++) {
+        crc = crc_table[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+    }
+    writeBE32(chunk, crc ^ 0xFFFFFFFF);
+
+    file.write((const char *) chunk.data(), chunk.size());
+}
+
+// Writes an 8-bit paletted PNG. The image data goes into uncompressed deflate blocks, which
+// keeps this free of a zlib dependency; the recording is the compact copy
+static bool writePNG(const std::string &filename, const uint8_t *frame, const std::vector<uint8_t> &palette) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write((const char *) signature, 8);
+
+    std::vector<uint8_t> header;
+    writeBE32(header, SCREEN_WIDTH);
+    writeBE32(header, SCREEN_HEIGHT);
+    header.insert(header.end(), {8, 3, 0, 0, 0}); // bit depth, paletted, deflate, no filter, no interlace
+    writeChunk(file, "IHDR", header);
+    writeChunk(file, "PLTE", palette);
+
+    // each row starts with filter type 0
+    std::vector<uint8_t> raw;
+    for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), &frame[y * SCREEN_WIDTH], &frame[(y + 1) * SCREEN_WIDTH]);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (uint32_t offset = 0; offset < raw.size(); offset += 0xFFFF) {
+        uint32_t size = std::min((uint32_t) raw.size() - offset, (uint32_t) 0xFFFF);
+        bool last = offset + size == raw.size();
+
+        zlib.insert(zlib.end(), {(uint8_t) last, (uint8_t) size, (uint8_t) (size >> 8),
+                                 (uint8_t) ~size, (uint8_t) (~size >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    writeBE32(zlib, (b << 16) | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+
+    return (bool) file;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cout << "Usage: " << argv[0] << " recording output_prefix" << std::endl;
+        std::cout << "Writes each frame to output_prefix000000.png, output_prefix000001.png, ..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    RecordingReader reader = RecordingReader(std::string(argv[1]));
+    std::string prefix = std::string(argv[2]);
+
+    // frames are COLOR indices, shown in the default driver colors
+    HeadlessGameboyDriver colors;
+    std::vector<uint8_t> palette;
+    for (uint8_t color = WHITE; color <= UNLIT; color++) {
+        uint32_t argb = colors.getARGBColor(COLOR(color));
+        palette.insert(palette.end(), {(uint8_t) (argb >> 16), (uint8_t) (argb >> 8), (uint8_t) argb});
+    }
+
+    uint32_t frames = 0;
+    uint64_t audio_samples = 0;
+
+    RECORD_TYPE type;
+    while (reader.next(type)) {
+        if (type == RECORD_AUDIO) {
+            audio_samples += reader.getAudio().size() / 2;
+            continue;
+        }
+
+        char number[16];
+        std::snprintf(number, sizeof(number), "%06u", frames);
+
+        std::string filename = prefix + number + ".png";
+        if (!writePNG(filename, reader.getFrame(), palette)) {
+            std::cout << "Unable to write " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        frames++;
+    }
+
+    std::cout << frames << " frames, " << (double) audio_samples / reader.getSampleRate() << " s of audio" << std::endl;
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
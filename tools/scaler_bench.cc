@@ -0,0 +1,80 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bus.h"
+#include "headless_gb_driver.h"
+#include "scaler.h"
+
+#define BENCH_ITERATIONS 2000
+#define DEFAULT_FRAMES 600
+
+
+// Times each scaler on one frame. The hashes let builds with and without SCALAR_SCALER be compared
+int main(int argc, char **argv) {
+    if (argc > 3) {
+        std::cout << "Usage: " << argv[0] << " [rom_file] [frames]" << std::endl;
+        std::cout << "Scales the last of frames frames of rom_file, or a test pattern without one" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> frame(SCREEN_WIDTH * SCREEN_HEIGHT);
+    if (argc >= 2) {
+        uint32_t frames = (argc == 3) ? std::stoul(argv[2]) : DEFAULT_FRAMES;
+
+        std::shared_ptr<Cartridge> cart = std::make_shared<Cartridge>(std::string(argv[1]));
+        HeadlessGameboyDriver driver = HeadlessGameboyDriver(frames);
+
+        Bus bus(&driver);
+        bus.insertCartridge(cart);
+        bus.setAudioEnabled(false);
+        bus.run();
+
+        std::copy(driver.getFrame(), driver.getFrame() + frame.size(), frame.begin());
+    } else {
+        // blocks, diagonals and single pixels, so every edge rule gets exercised
+        for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+            for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+                frame[y * SCREEN_WIDTH + x] = ((x / 8 + y / 8) & 1) ? ((x + y) / 5) & 0x03 : (x * y) % 7 == 0;
+            }
+        }
+    }
+
+    struct Bench {
+        std::string name;
+        uint32_t factor;
+        std::function<void(const uint8_t *, uint8_t *)> scale;
+    };
+
+    std::vector<Bench> benches = {
+        {"nearest 2x", 2, [](const uint8_t *in, uint8_t *out) { scaleNearest(in, out, SCREEN_WIDTH, SCREEN_HEIGHT, 2); }},
+        {"nearest 3x", 3, [](const uint8_t *in, uint8_t *out) { scaleNearest(in, out, SCREEN_WIDTH, SCREEN_HEIGHT, 3); }},
+        {"nearest 4x", 4, [](const uint8_t *in, uint8_t *out) { scaleNearest(in, out, SCREEN_WIDTH, SCREEN_HEIGHT, 4); }},
+        {"scale2x",    2, [](const uint8_t *in, uint8_t *out) { scale2x(in, out, SCREEN_WIDTH, SCREEN_HEIGHT); }},
+        {"scale3x",    3, [](const uint8_t *in, uint8_t *out) { scale3x(in, out, SCREEN_WIDTH, SCREEN_HEIGHT); }},
+    };
+
+    for (Bench &bench : benches) {
+        std::vector<uint8_t> out(frame.size() * bench.factor * bench.factor);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            bench.scale(frame.data(), out.data());
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+
+        // FNV-1a hash of the output
+        uint64_t hash = 0xCBF29CE484222325;
+        for (uint8_t pixel : out) {
+            hash = (hash ^ pixel) * 0x100000001B3;
+        }
+
+        std::cout << bench.name << ": " << elapsed.count() / BENCH_ITERATIONS << " us/frame, "
+                  << std::hex << hash << std::dec << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
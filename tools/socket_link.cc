@@ -0,0 +1,41 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "bus.h"
+#include "headless_gb_driver.h"
+#include "socket_link.h"
+
+#define DEFAULT_FRAMES 3600
+
+
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " rom_file listen|connect address [frames] [window]" << std::endl;
+        std::cout << "Runs a machine without a window or audio, linked to another process. Addresses are" << std::endl;
+        std::cout << "unix:path or host:port, and window is how many cycles to run ahead of the other side" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    LINK_ROLE role = (std::string(argv[2]) == "listen") ? LINK_LISTEN : LINK_CONNECT;
+    uint32_t frames = (argc >= 5) ? std::stoul(argv[4]) : DEFAULT_FRAMES;
+    uint32_t window = (argc == 6) ? std::stoul(argv[5]) : DEFAULT_LINK_WINDOW;
+
+    HeadlessGameboyDriver driver = HeadlessGameboyDriver(frames);
+
+    Bus bus(&driver);
+    bus.insertCartridge(std::make_shared<Cartridge>(std::string(argv[1])));
+    bus.setAudioEnabled(false);
+
+    SocketLink link(&bus, role, std::string(argv[3]), window);
+
+    auto start = std::chrono::steady_clock::now();
+    link.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << driver.getFrameCount() << " frames in " << elapsed.count() << " s, "
+              << link.getTransferCount() << " bytes transferred, last frame " << std::hex << driver.getFrameHash() << std::endl;
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file